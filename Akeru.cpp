@@ -164,6 +164,28 @@ bool Akeru::sendMessage(const String payload)
 	}
 }
 
+bool Akeru::sendHeartbeat(bool bit)
+{
+  //  Send a bit frame with AT$SB= to show that we are alive.  The frame has no payload bytes,
+  //  so it takes about half the airtime and energy of a 12-byte message.
+  //  TD LAN has no bit frames, so emulation mode sends an empty message.
+	if (_emulationMode) return sendMessage("");
+	if (!isReady()) return false; // prevent user from sending to many messages
+
+	String message = (String) ATSIGFOXBIT + (bit ? '1' : '0');
+	String data = "";
+	if (sendATCommand(message, ATSIGFOXTX_TIMEOUT, data))
+	{
+    echoPort->println(data);
+		_lastSend = millis();
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+
 bool Akeru::getTemperature(int &temperature)
 {
 	String data = "";
@@ -198,24 +220,50 @@ bool Akeru::getID(String &id, String &pac)
 	}
 }
 
+bool Akeru::getTelemetry(float &temperature, float &voltage, unsigned long maxAge)
+{
+  //  Returns the temperature and power supply voltage of the module.  If the last reading is
+  //  newer than maxAge milliseconds, return it without talking to the module.  The module
+  //  answers one AT command at a time, so the two commands are pipelined in one session.
+  if (!_telemetryValid || millis() - _telemetryTime >= maxAge)
+  {
+    const String commands[] = { ATTEMPERATURE, ATVOLTAGE };
+    String data[2];
+    if (!sendATCommands(commands, 2, data, ATCOMMAND_TIMEOUT)) return false;
+    _telemetryVoltage = parseVoltage(data[1]);
+    _telemetryTemperature = (int) data[0].toInt();
+    _telemetryTime = millis();
+    _telemetryValid = true;
+  }
+  temperature = _telemetryTemperature;
+  voltage = _telemetryVoltage;
+  return true;
+}
+
+float Akeru::parseVoltage(String data)
+{
+  //  Returns the voltage from the response "3.28".
+  //  voltage = data.toFloat();
+  //  Since Bean+ doesn't support toFloat(), we convert to int and divide by the decimal place.
+  int dotPos = data.indexOf('.');
+  int divisor = 0;
+  if (dotPos >= 0) {  //  Expect 1.
+    divisor = data.length() - dotPos - 1;
+    data = data.substring(0, (unsigned int) dotPos) + data.substring((unsigned int) dotPos + 1);
+  }
+  float voltage = data.toInt();
+  for (int i = 0; i < divisor; i++) {
+    voltage = voltage / 10.0;
+  }
+  return voltage;
+}
+
 bool Akeru::getVoltage(float &voltage)
 {
 	String data = "";
 	if (sendATCommand(ATVOLTAGE, ATCOMMAND_TIMEOUT, data))
 	{
-    //  Returns the response "3.28".
-		//  voltage = data.toFloat();
-    //  Since Bean+ doesn't support toFloat(), we convert to int and divide by the decimal place.
-    int dotPos = data.indexOf('.');
-    int divisor = 0;
-    if (dotPos >= 0) {  //  Expect 1.
-      divisor = data.length() - dotPos - 1;
-      data = data.substring(0, (unsigned int) dotPos) + data.substring((unsigned int) dotPos + 1);
-    }
-    voltage = data.toInt();
-    for (int i = 0; i < divisor; i++) {
-      voltage = voltage / 10.0;
-    }
+		voltage = parseVoltage(data);
 		return true;
 	}
 	else
@@ -473,6 +521,34 @@ bool Akeru::sendATCommand(const String command, const int timeout, String &dataO
 	serialPort->flush();
 	serialPort->listen();
 
+	const bool result = exchangeATCommand(command, timeout, dataOut);
+	serialPort->end();
+	return result;
+}
+
+bool Akeru::sendATCommands(const String commands[], uint8_t count, String dataOut[], const int timeout)
+{
+	//  Send independent read-only commands, e.g. temperature and voltage, in one session.
+	//  Each command is written as soon as the previous response ends, and dataOut[i] returns
+	//  the data of commands[i].  Saves the serial restart of each command.
+	serialPort->begin(9600);
+	delay(200);
+	serialPort->flush();
+	serialPort->listen();
+
+	bool result = true;
+	for (uint8_t i = 0; result && i < count; i++)
+	{
+		dataOut[i] = "";
+		result = exchangeATCommand(commands[i], timeout, dataOut[i]);
+	}
+	serialPort->end();
+	return result;
+}
+
+bool Akeru::exchangeATCommand(const String command, const int timeout, String &dataOut)
+{
+	//  Send the command and read its response.  The serial interface must be started.
 	// Add CRLF to the command
 	String ATCommand = "";
 	ATCommand.concat(command);
@@ -507,7 +583,15 @@ bool Akeru::sendATCommand(const String command, const int timeout, String &dataO
 		currentTime = millis();
 	}while(((currentTime - startTime) < timeout) && response.endsWith(ATOK) == false);
 
-	serialPort->end();
+	// Wait briefly for the line terminator after OK, so that it isn't read as part of the next response.
+	startTime = millis();
+	while (response.endsWith(ATOK) && ((unsigned int) millis() - startTime) < ATLINEEND_TIMEOUT)
+	{
+		if (serialPort->available() <= 0) continue;
+		rxChar = (char)serialPort->read();
+		if (rxChar == '\n') break;
+	}
+
   String res = response;
   while (res.length() > 0 && (res.charAt(0) == '\r' || res.charAt(0) == '\n'))
     res = res.substring(1);  //  Strip off leading newline.
@@ -584,7 +668,7 @@ bool Akeru::sendATCommand(const String command, const int timeout, String &dataO
 }
 
 //  Singapore and Taiwan: 920.8 MHz Uplink, 922.3 MHz Downlink
-//  ETSI (Europe): 868.2 MHz
+//  ETSI (Europe): 868.13 MHz
 
 bool Akeru::getFrequency(String &result)
 {
@@ -606,16 +690,7 @@ bool Akeru::setFrequencySG(String &result)
 {
 	//  Set the frequency for the SIGFOX module to Singapore frequency.
 	//  Must be followed by writeSettings and reboot commands.
-	String data = "";
-	if (sendATCommand(ATSET_FREQUENCY_SG, ATCOMMAND_TIMEOUT, data))
-	{
-		result = data;
-		return true;
-	}
-	else
-	{
-		return false;
-	}
+	return setZoneFrequency(4, result);
 }
 
 bool Akeru::setFrequencyTW(String &result)
@@ -627,10 +702,24 @@ bool Akeru::setFrequencyTW(String &result)
 
 bool Akeru::setFrequencyETSI(String &result)
 {
-	//  Set the frequency for the SIGFOX module to ETSI frequency for Europe or demo for 868 MHz base station.
+	//  Set the frequency for the SIGFOX module to ETSI frequency for Europe (RCZ1).
+	//  Must be followed by writeSettings and reboot commands.
+	return setZoneFrequency(1, result);
+}
+
+bool Akeru::setFrequencyUS(String &result)
+{
+	//  Set the frequency for the SIGFOX module to US frequency (RCZ2).
+	//  Must be followed by writeSettings and reboot commands.
+	return setZoneFrequency(2, result);
+}
+
+bool Akeru::setZoneFrequency(uint8_t zone, String &result)
+{
+	//  Set the uplink frequency of the zone, from the zone profile.
 	//  Must be followed by writeSettings and reboot commands.
 	String data = "";
-	if (sendATCommand(ATSET_FREQUENCY_ETSI, ATCOMMAND_TIMEOUT, data))
+	if (sendATCommand(String(ATSET_FREQUENCY) + zoneProfile(zone).uplinkFrequency, ATCOMMAND_TIMEOUT, data))
 	{
 		result = data;
 		return true;
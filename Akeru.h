@@ -50,17 +50,21 @@
 #define ATPOWER "ATS302"
 #define ATDOWNLINK "AT$SB=1,2,1"
 #define ATSIGFOXTX "AT$SS="
+#define ATSIGFOXBIT "AT$SB="
 #define ATTDLANTX "AT$SL="
 #define DOWNLINKEND "+RX END"
 
 const unsigned int AKERU_RX = 4;  //  Receive port for UnaBiz / Akene Dev Kit
 const unsigned int AKERU_TX = 5;  //  Transmit port for UnaBiz / Akene Dev Kit
 
+//  Set the uplink frequency of the SIGFOX module in Hz, from the zone profile:
+#define ATSET_FREQUENCY "AT$IF="
+
 //  Set frequency of the SIGFOX module to Singapore and Taiwan (920.8 MHz):
 #define ATSET_FREQUENCY_SG "AT$IF=920800000"
 
-//  Set frequency of the SIGFOX module to ETSI (Europe, 868.2 MHz):
-#define ATSET_FREQUENCY_ETSI "AT$IF=868200000"
+//  Set frequency of the SIGFOX module to ETSI (Europe, 868.13 MHz), same as setFrequencyETSI():
+#define ATSET_FREQUENCY_ETSI "AT$IF=868130000"
 
 //  Get frequency used by the SIGFOX module.
 #define ATGET_FREQUENCY "AT$IF?"
@@ -82,6 +86,7 @@ const unsigned int AKERU_TX = 5;  //  Transmit port for UnaBiz / Akene Dev Kit
 #define ATCOMMAND_TIMEOUT (3000)
 #define ATSIGFOXTX_TIMEOUT (30000)
 #define ATDOWNLINK_TIMEOUT (45000)
+#define ATLINEEND_TIMEOUT (20)  //  Wait for the line end after OK.
 
 // Set to 1 if you want to print the AT commands and answers
 // on the serial monitor, set to 0 otherwise.
@@ -100,6 +105,7 @@ class Akeru
     bool isReady();
     bool sendMessage(const String payload);  //  Send the payload of hex digits to the network, max 12 bytes.
 		bool sendString(const String str);  //  Sending a text string, max 12 characters allowed.
+    bool sendHeartbeat(bool bit = true);  //  Send a bit frame, the shortest frame, to show that we are alive.
     bool receive(String &data);  //  Receive a message.
     bool enterCommandMode() {}  //  Enter Command Mode for sending module commands, not data.
     bool exitCommandMode() {}  //  Exit Command Mode so we can send data.
@@ -119,11 +125,13 @@ class Akeru
     bool setFrequencyETSI(String &result);
     //  Set the frequency for the SIGFOX module to US frequency (RCZ2).
     bool setFrequencyUS(String &result);
+    bool setZoneFrequency(uint8_t zone, String &result);  //  Set the uplink frequency of the zone 1 to 4.
     bool writeSettings(String &result); //  Write frequency and other settings to flash memory of the module.
     bool reboot(String &result);  //  Reboot the SIGFOX module.
     bool getTemperature(int &temperature);
     bool getID(String &id, String &pac);  //  Get the SIGFOX ID and PAC for the module.
     bool getVoltage(float &voltage);
+    bool getTelemetry(float &temperature, float &voltage, unsigned long maxAge = TELEMETRY_MAX_AGE);  //  Read temperature and voltage, or reuse the last reading.
     bool getHardware(String &hardware);
     bool getFirmware(String &firmware);
     bool getPower(int &power);
@@ -155,6 +163,9 @@ class Akeru
 private:
     bool sendAT();
 		bool sendATCommand(const String command, const int timeout, String &dataOut);
+		bool sendATCommands(const String commands[], uint8_t count, String dataOut[], const int timeout);  //  Pipeline read-only commands in one session.
+		bool exchangeATCommand(const String command, const int timeout, String &dataOut);  //  Send a command in a started session.
+		float parseVoltage(String data);  //  Convert the voltage response to volts.
 		SoftwareSerial* serialPort;
     Print *echoPort;  //  Port for sending echo output.  Defaults to Serial.
     Print *lastEchoPort;  //  Last port used for sending echo output.
@@ -163,6 +174,10 @@ private:
     unsigned int _sequenceNumber;  //  Sequence number for the message.
     String _id = "";  //  SIGFOX device ID.
     String _pac = "";  //  SIGFOX PAC.
+    unsigned long _telemetryTime = 0;  //  Timestamp of the last telemetry reading.
+    bool _telemetryValid = false;  //  True after the first telemetry reading.
+    float _telemetryTemperature = 0;  //  Module temperature at the last telemetry reading.
+    float _telemetryVoltage = 0;  //  Module voltage at the last telemetry reading.
 };
 
 #endif // AKERU_H
@@ -0,0 +1,141 @@
+//  Library for detecting abnormal sensor values between sends, e.g. a cold-chain temperature
+//  that drifts suddenly.  Tracks the moving mean and variance of each field with integer math
+//  and sends an alert message when a value is too many standard deviations from the mean.
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+#include "SIGFOX.h"
+
+static const long MAX_DIFF = 2000;  //  Limit the difference from the mean to 200.0 so the variance fits 32 bits.
+
+AnomalyDetector::AnomalyDetector(Message &msg0) {
+  //  Send the alerts with this message.
+  msg = &msg0;
+}
+
+int AnomalyDetector::addField(const char *name, float zThreshold, float minDeviation) {
+  //  Watch a field.  Returns the field index, or -1 if too many fields.
+  return addField(Message::nameCode(name), zThreshold, minDeviation);
+}
+
+int AnomalyDetector::addField(unsigned int nameCode, float zThreshold, float minDeviation) {
+  //  Watch a field.  The value is abnormal if it is at least zThreshold standard deviations
+  //  from the mean.  The standard deviation is taken as at least minDeviation, so that
+  //  a value that hardly changes doesn't alert on a tiny change.
+  if (fieldCount >= MAX_ANOMALY_FIELDS) return -1;
+  Field &field = fields[fieldCount];
+  field.nameCode = nameCode;
+  field.zThreshold = Message::toTenths(zThreshold);
+  field.minDeviation = Message::toTenths(minDeviation);
+  if (field.minDeviation < 1) field.minDeviation = 1;
+  field.value = 0;
+  field.mean = 0;
+  field.variance = 0;
+  field.zScore = 0;
+  field.count = 0;
+  field.abnormal = false;
+  return fieldCount++;
+}
+
+void AnomalyDetector::setScheduler(Scheduler &scheduler0) {
+  //  Alerts use the send credits of this scheduler, so that the alerts and
+  //  the periodic sends together comply with the duty cycle.
+  scheduler = &scheduler0;
+}
+
+void AnomalyDetector::setSmoothing(uint8_t shift) {
+  //  Mean and variance follow 1 / 2^shift of each new value.  Larger shift is slower to follow.
+  smoothing = shift;
+}
+
+int AnomalyDetector::deviationOf(const Field &field) {
+  //  Return the standard deviation in tenths.  Variance is scaled by 256, so the root is scaled by 16.
+  int deviation = (int) (MotionDetector::isqrt(field.variance) / 16);
+  return (deviation < field.minDeviation) ? field.minDeviation : deviation;
+}
+
+bool AnomalyDetector::update(int index, float value0) {
+  //  Add a value for the field.  The value is compared with the mean and variance
+  //  before the value is added to them.  Returns true if the value is abnormal and
+  //  an alert is now pending.  Each excursion alerts once, until the z-score drops
+  //  below half the threshold.
+  if (index < 0 || index >= fieldCount) return false;
+  Field &field = fields[index];
+  const int value = Message::toTenths(value0);
+  field.value = value;
+  if (field.count == 0) {
+    //  Start the mean at the first value.
+    field.mean = (long) value * 256;
+    field.variance = 0;
+    field.count = 1;
+    return false;
+  }
+  //  Compare with the mean and standard deviation.
+  const long diffScaled = (long) value * 256 - field.mean;
+  long diff = diffScaled / 256;
+  const long absDiff = diff < 0 ? -diff : diff;
+  long zScore = absDiff * 10 / deviationOf(field);
+  if (zScore > 32767) zScore = 32767;
+  field.zScore = (int) (diff < 0 ? -zScore : zScore);
+
+  //  Update the moving mean and variance.
+  if (diff > MAX_DIFF) diff = MAX_DIFF;
+  if (diff < -MAX_DIFF) diff = -MAX_DIFF;
+  field.mean += diffScaled >> smoothing;
+  field.variance += ((unsigned long) (diff * diff) * 256) >> smoothing;
+  field.variance -= field.variance >> smoothing;
+  if (field.count < ANOMALY_WARMUP) { field.count++; return false; }
+
+  if (field.abnormal) {
+    if (zScore * 2 < field.zThreshold) field.abnormal = false;
+    return false;
+  }
+  if (zScore < field.zThreshold) return false;
+  field.abnormal = true;
+  //  Keep the more abnormal alert if one is already pending.
+  if (alertField >= 0 && (alertZScore < 0 ? -alertZScore : alertZScore) > zScore) return true;
+  alertField = index;
+  alertValue = value;
+  alertDeviation = (int) (diffScaled / 256);
+  alertZScore = field.zScore;
+  return true;
+}
+
+bool AnomalyDetector::isAlertPending() {
+  return alertField >= 0;
+}
+
+bool AnomalyDetector::sendAlert() {
+  //  Send the pending alert: the abnormal value, its difference from the mean, and the z-score.
+  //  The z-score is left out when the message sequence number takes its space.  Returns false if there is no alert, or the scheduler has no send credits now.
+  //  The alert stays pending if not sent, so call this again later.
+  if (alertField < 0) return false;
+  if (scheduler && !scheduler->takeSendCredit()) return false;
+  msg->reset();
+  msg->addField(fields[alertField].nameCode, alertValue / 10.0f);
+  msg->addField(Message::nameCode("dev"), alertDeviation / 10.0f);
+  if (msg->getCapacity() >= 4) msg->addField(Message::nameCode("z"), alertZScore / 10.0f);
+  if (!msg->send()) return false;
+  alertField = -1;
+  return true;
+}
+
+float AnomalyDetector::getMean(int index) {
+  if (index < 0 || index >= fieldCount) return 0;
+  return fields[index].mean / 2560.0f;
+}
+
+float AnomalyDetector::getDeviation(int index) {
+  if (index < 0 || index >= fieldCount) return 0;
+  return deviationOf(fields[index]) / 10.0f;
+}
+
+float AnomalyDetector::getZScore(int index) {
+  if (index < 0 || index >= fieldCount) return 0;
+  return fields[index].zScore / 10.0f;
+}
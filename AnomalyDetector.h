@@ -0,0 +1,58 @@
+//  Library for detecting abnormal sensor values between sends, e.g. a cold-chain temperature
+//  that drifts suddenly.  Tracks the moving mean and variance of each field with integer math
+//  and sends an alert message when a value is too many standard deviations from the mean.
+#ifndef UNABIZ_ARDUINO_ANOMALYDETECTOR_H
+#define UNABIZ_ARDUINO_ANOMALYDETECTOR_H
+
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+const uint8_t MAX_ANOMALY_FIELDS = 4;  //  Max number of fields that may be watched.
+const uint8_t ANOMALY_SMOOTHING = 4;  //  Mean and variance follow 1/16 of each new value.
+const uint8_t ANOMALY_WARMUP = 16;  //  Don't detect until we have seen this many values.
+
+class AnomalyDetector
+{
+public:
+  AnomalyDetector(Message &msg);  //  Send the alerts with this message.
+  int addField(const char *name, float zThreshold = 3.0, float minDeviation = 0.5);  //  Watch a field.  Returns the field index, or -1 if too many.
+  int addField(unsigned int nameCode, float zThreshold = 3.0, float minDeviation = 0.5);  //  Same as above, name encoded by Message::nameCode().
+  void setScheduler(Scheduler &scheduler);  //  Alerts use the send credits of this scheduler to comply with the duty cycle.
+  void setSmoothing(uint8_t shift);  //  Mean and variance follow 1 / 2^shift of each new value.
+  bool update(int field, float value);  //  Add a value.  Returns true if the value is abnormal and an alert is now pending.
+  bool isAlertPending();  //  Return true if an alert is waiting to be sent.
+  bool sendAlert();  //  Send the pending alert.  Returns false if none, or the duty cycle doesn't allow it yet.
+  float getMean(int field);  //  Return the moving mean of the field.
+  float getDeviation(int field);  //  Return the moving standard deviation of the field.
+  float getZScore(int field);  //  Return the number of standard deviations of the last value from the mean.
+
+private:
+  struct Field {
+    unsigned int nameCode;  //  Name encoded by Message::nameCode().
+    int zThreshold;  //  Abnormal if the z-score is at least this, in tenths.
+    int minDeviation;  //  Standard deviation is at least this, in tenths of the value, so steady values don't alert.
+    int value;  //  Last value in tenths.
+    long mean;  //  Moving mean in tenths, scaled by 256.
+    unsigned long variance;  //  Moving variance in tenths squared, scaled by 256.
+    int zScore;  //  z-score of the last value in tenths.
+    uint8_t count;  //  Number of values seen, up to ANOMALY_WARMUP.
+    bool abnormal;  //  True until the z-score drops below half the threshold, so we alert once for each excursion.
+  };
+
+  int deviationOf(const Field &field);  //  Return the standard deviation in tenths.
+
+  Message *msg;  //  Message for sending the alerts.
+  Scheduler *scheduler = 0;  //  Scheduler that governs the duty cycle.
+  Field fields[MAX_ANOMALY_FIELDS];
+  uint8_t fieldCount = 0;
+  uint8_t smoothing = ANOMALY_SMOOTHING;  //  Mean and variance follow 1 / 2^smoothing of each new value.
+  int alertField = -1;  //  Field of the pending alert, or -1 if none.
+  int alertValue = 0, alertDeviation = 0, alertZScore = 0;  //  Pending alert in tenths.
+};
+
+#endif  //  UNABIZ_ARDUINO_ANOMALYDETECTOR_H
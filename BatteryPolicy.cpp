@@ -0,0 +1,155 @@
+//  Library for stretching the send interval as the battery drains, so that the device
+//  lasts the whole season instead of dying suddenly.  Samples the supply voltage from the
+//  SIGFOX module, fits the discharge trend, and slows down the Scheduler.
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+#include "SIGFOX.h"
+
+static BatteryPolicy *activePolicy = 0;  //  The policy sampled by the scheduler.
+
+static void sampleBattery(Scheduler &) {
+  //  Sample function for the scheduler.
+  if (activePolicy) activePolicy->sample();
+}
+
+BatteryPolicy::BatteryPolicy(Radiocrafts &transceiver) {
+  radiocrafts = &transceiver;
+}
+
+BatteryPolicy::BatteryPolicy(Wisol &transceiver) {
+  wisol = &transceiver;
+}
+
+void BatteryPolicy::begin(Scheduler &scheduler0, unsigned long period) {
+  //  Sample the voltage every period milliseconds and stretch the send interval of the scheduler.
+  //  Call this after scheduler.setSendInterval(), which is taken as the interval for a full battery.
+  scheduler = &scheduler0;
+  baseInterval = scheduler->getSendInterval();
+  activePolicy = this;
+  scheduler->addSensor(period, sampleBattery);
+}
+
+void BatteryPolicy::setVoltageRange(unsigned int emptyMilliVolts0, unsigned int fullMilliVolts0) {
+  //  Voltages for 0% and 100%, which depend on the battery type.
+  emptyMilliVolts = emptyMilliVolts0;
+  fullMilliVolts = (fullMilliVolts0 > emptyMilliVolts0) ? fullMilliVolts0 : emptyMilliVolts0 + 1;
+}
+
+bool BatteryPolicy::sample() {
+  //  Read the voltage from the module and update the policy.
+  float voltage = 0;
+  bool ok = false;
+  //  getVoltage() enters and exits command mode itself for Radiocrafts.
+  if (wisol) ok = wisol->getVoltage(voltage);
+  else if (radiocrafts) ok = radiocrafts->getVoltage(voltage);
+  if (!ok) return false;
+  record((unsigned int) (voltage * 1000 + 0.5));
+  return true;
+}
+
+void BatteryPolicy::record(unsigned int mv) {
+  //  Record a voltage sample taken now and update the policy.
+  record(mv, millis());
+}
+
+void BatteryPolicy::record(unsigned int mv, unsigned long time) {
+  //  Record a voltage sample taken at the time in milliseconds and update the policy.
+  //  BATTERY_AVERAGE samples are averaged into each point, so the points span days and the
+  //  trend isn't fitted to the daily temperature swing.  The newest point is used while it's
+  //  being averaged.  Times are kept in milliseconds and subtracted as unsigned values, so
+  //  the fit still works after millis() wraps at 49.7 days.
+  lastMilliVolts = mv;
+  if (averaged == 0 || averaged >= BATTERY_AVERAGE) {
+    next = (next + 1) % BATTERY_SAMPLES;
+    if (count < BATTERY_SAMPLES) count++;
+    averaged = 0;  sumMilliVolts = 0;  sumOffsets = 0;
+    startTime = time;
+  }
+  const uint8_t newest = (next + BATTERY_SAMPLES - 1) % BATTERY_SAMPLES;
+  averaged++;
+  sumMilliVolts += mv;
+  sumOffsets += time - startTime;
+  milliVolts[newest] = (unsigned int) (sumMilliVolts / averaged);
+  times[newest] = startTime + sumOffsets / averaged;
+  update();
+}
+
+void BatteryPolicy::update() {
+  //  Fit a straight line through the samples by least squares to get the discharge trend,
+  //  which is less noisy than comparing two samples.  Then stretch the intervals
+  //  according to the battery level, and stretch more if the trend shows empty soon.
+  if (count >= 2) {
+    const uint8_t oldest = (next + BATTERY_SAMPLES - count) % BATTERY_SAMPLES;  //  next is after the newest point.
+    int64_t sumX = 0, sumY = 0, sumXY = 0, sumXX = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      const uint8_t j = (oldest + i) % BATTERY_SAMPLES;
+      const int64_t x = (int64_t) ((times[j] - times[oldest]) / 60000);  //  Minutes, wrap-safe.
+      const int64_t y = milliVolts[j];
+      sumX += x;  sumY += y;  sumXY += x * y;  sumXX += x * x;
+    }
+    const int64_t denominator = count * sumXX - sumX * sumX;
+    if (denominator != 0) slope = (long) ((count * sumXY - sumX * sumY) * 24 * 60 / denominator);
+  }
+  const uint8_t level = getLevel();
+  uint8_t factor = 1;
+  if (level < 10) factor = 8;
+  else if (level < 25) factor = 4;
+  else if (level < 50) factor = 2;
+  const long hoursLeft = getHoursLeft();
+  if (hoursLeft >= 0 && hoursLeft < (long) BATTERY_WARNING_HOURS) factor = factor * 2;
+  stretchFactor = (factor > MAX_STRETCH) ? MAX_STRETCH : factor;
+  if (scheduler) scheduler->setSendInterval(stretch(baseInterval));
+}
+
+uint8_t BatteryPolicy::getStretch() {
+  //  Return how many times longer the intervals should be, from 1 to MAX_STRETCH.
+  return stretchFactor;
+}
+
+unsigned long BatteryPolicy::stretch(unsigned long interval) {
+  //  Return the interval stretched for the battery level, e.g. for the downlink interval.
+  return interval * stretchFactor;
+}
+
+unsigned int BatteryPolicy::getMilliVolts() {
+  if (count == 0) return fullMilliVolts;
+  return lastMilliVolts;
+}
+
+uint8_t BatteryPolicy::getLevel() {
+  //  Return the battery level in percent, assuming the voltage drops linearly.
+  const unsigned int mv = getMilliVolts();
+  if (mv <= emptyMilliVolts) return 0;
+  if (mv >= fullMilliVolts) return 100;
+  return (uint8_t) ((unsigned long) (mv - emptyMilliVolts) * 100 / (fullMilliVolts - emptyMilliVolts));
+}
+
+long BatteryPolicy::getSlope() {
+  //  Return the discharge trend in millivolts per day.  Negative when draining.
+  return slope;
+}
+
+long BatteryPolicy::getHoursLeft() {
+  //  Return the hours until empty according to the trend, or -1 if not draining.
+  const unsigned int mv = getMilliVolts();
+  if (slope >= 0 || count < 2) return -1;
+  if (mv <= emptyMilliVolts) return 0;
+  return (long) (mv - emptyMilliVolts) * 24 / -slope;
+}
+
+bool BatteryPolicy::addFields(Message &msg) {
+  //  Add the voltage in hundredths of a volt, the level in percent, and the trend in
+  //  millivolts per day to the message, for diagnostics.  Returns false if they don't fit.
+  long trend = slope;
+  if (trend > 3276) trend = 3276;
+  if (trend < -3276) trend = -3276;
+  if (!msg.addField(Message::nameCode("bat"), (int) (getMilliVolts() / 10))) return false;
+  if (!msg.addField(Message::nameCode("lvl"), (int) getLevel())) return false;
+  return msg.addField(Message::nameCode("slp"), (int) trend);
+}
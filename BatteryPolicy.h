@@ -0,0 +1,64 @@
+//  Library for stretching the send interval as the battery drains, so that the device
+//  lasts the whole season instead of dying suddenly.  Samples the supply voltage from the
+//  SIGFOX module, fits the discharge trend, and slows down the Scheduler.
+#ifndef UNABIZ_ARDUINO_BATTERYPOLICY_H
+#define UNABIZ_ARDUINO_BATTERYPOLICY_H
+
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+const uint8_t BATTERY_SAMPLES = 8;  //  Number of averaged voltage points used to fit the discharge trend.
+const uint8_t BATTERY_AVERAGE = 6;  //  Each point averages 6 samples, so 8 hourly points span 2 days of temperature swings.
+const unsigned long BATTERY_SAMPLE_PERIOD = (unsigned long) 60 * 60 * 1000;  //  Sample the voltage every hour.
+const unsigned int BATTERY_FULL = 3600;  //  Default full voltage in millivolts.
+const unsigned int BATTERY_EMPTY = 3000;  //  Default empty voltage in millivolts.
+const unsigned int BATTERY_WARNING_HOURS = 7 * 24;  //  Slow down more if the trend shows empty within a week.
+const uint8_t MAX_STRETCH = 8;  //  Send up to 8 times less often when the battery is low.
+
+//  Only one BatteryPolicy may be added to the scheduler because the sample function is shared.
+class BatteryPolicy
+{
+public:
+  BatteryPolicy(Radiocrafts &transceiver);  //  Read the voltage from Radiocrafts.
+  BatteryPolicy(Wisol &transceiver);  //  Read the voltage from Wisol.
+  void begin(Scheduler &scheduler, unsigned long period = BATTERY_SAMPLE_PERIOD);  //  Sample the voltage with the scheduler and stretch its send interval.
+  void setVoltageRange(unsigned int emptyMilliVolts, unsigned int fullMilliVolts);  //  Voltages for 0% and 100%.
+  bool sample();  //  Read the voltage from the module.  Called by the scheduler.
+  void record(unsigned int milliVolts);  //  Record a voltage sample, e.g. read by an analog pin, and update the policy.
+  void record(unsigned int milliVolts, unsigned long time);  //  Record a voltage sample taken at the time in milliseconds.
+  uint8_t getStretch();  //  Return how many times longer the intervals should be, from 1 to MAX_STRETCH.
+  unsigned long stretch(unsigned long interval);  //  Return the interval stretched for the battery level.
+  unsigned int getMilliVolts();  //  Return the last voltage sample.
+  uint8_t getLevel();  //  Return the battery level in percent.
+  long getSlope();  //  Return the discharge trend in millivolts per day.  Negative when draining.
+  long getHoursLeft();  //  Return the hours until empty according to the trend, or -1 if not draining.
+  bool addFields(Message &msg);  //  Add the voltage, level and trend to the message for diagnostics.
+
+private:
+  void update();  //  Fit the trend and update the stretch.
+
+  Radiocrafts *radiocrafts = 0;
+  Wisol *wisol = 0;
+  Scheduler *scheduler = 0;  //  Scheduler to slow down.
+  unsigned long baseInterval = SEND_DELAY;  //  Send interval of the scheduler when the battery is full.
+  unsigned int emptyMilliVolts = BATTERY_EMPTY;
+  unsigned int fullMilliVolts = BATTERY_FULL;
+  unsigned int milliVolts[BATTERY_SAMPLES];  //  Circular buffer of averaged voltage points.
+  unsigned long times[BATTERY_SAMPLES];  //  Average millis() time of each point.  Compared by wrap-safe differences.
+  uint8_t next = 0;  //  Next position in the buffer.
+  uint8_t count = 0;  //  Number of points in the buffer, including the point being averaged.
+  uint8_t averaged = 0;  //  Number of samples averaged into the newest point.
+  unsigned long sumMilliVolts = 0;  //  Sum of the samples of the newest point.
+  unsigned long sumOffsets = 0;  //  Sum of the sample times of the newest point, from startTime.
+  unsigned long startTime = 0;  //  Time of the first sample of the newest point.
+  unsigned int lastMilliVolts = 0;  //  Last voltage sample.
+  long slope = 0;  //  Millivolts per day.
+  uint8_t stretchFactor = 1;  //  How many times longer the intervals should be.
+};
+
+#endif  //  UNABIZ_ARDUINO_BATTERYPOLICY_H
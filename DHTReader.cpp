@@ -0,0 +1,164 @@
+//  Library for reading DHT11 / DHT22 temperature and humidity sensors without blocking.
+//  The DHT library reads the sensor with interrupts disabled for about 5 milliseconds, which
+//  corrupts the SoftwareSerial responses from the SIGFOX module.  Instead we time the pulses
+//  from the sensor with an interrupt and decode them later in poll().
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+#include "SIGFOX.h"
+
+static const uint8_t PULSE_ONE = 100;  //  Bit is 1 if the falling edges are more than 100 microseconds apart.
+static const uint8_t FIRST_BIT = 2;  //  Pulse for the first bit.  Pulses 0 and 1 are the sensor response.
+
+static DHTReader *activeReader = 0;  //  The reader watched by the interrupt.
+
+DHTReader::DHTReader(uint8_t pin0, uint8_t type0) {
+  pin = pin0;
+  type = type0;
+}
+
+bool DHTReader::begin() {
+  //  Set up the pin.  Returns false if the pin doesn't support interrupts.
+#ifdef ARDUINO
+  if (digitalPinToInterrupt(pin) == NOT_AN_INTERRUPT) return false;
+  pinMode(pin, INPUT_PULLUP);
+#endif  //  ARDUINO
+  return true;
+}
+
+void DHTReader::setScheduler(Scheduler &scheduler0, int temperatureField0, int humidityField0) {
+  //  When a reading is decoded, record it in these scheduler fields.  Pass -1 to skip a field.
+  scheduler = &scheduler0;
+  temperatureField = temperatureField0;
+  humidityField = humidityField0;
+}
+
+bool DHTReader::start() {
+  //  Start a reading by pulling the pin low.  The sensor answers after we release the pin in poll().
+  //  DHT11 may be read every second, DHT21 and DHT22 every 2 seconds.
+  //  Returns false if a reading is in progress or the sensor was read too recently.
+  const unsigned long now = millis();
+  const unsigned long minInterval = (type == 11) ? 1000 : 2000;
+  if (state != IDLE) return false;
+  if (readBefore && now - lastRead < minInterval) return false;
+#ifdef ARDUINO
+  digitalWrite(pin, LOW);
+  pinMode(pin, OUTPUT);
+#endif  //  ARDUINO
+  state = REQUEST;
+  stateTime = now;
+  return true;
+}
+
+unsigned long DHTReader::poll() {
+  //  Continue the reading.  Returns the milliseconds until poll() should be called again,
+  //  or DHT_IDLE if there is no reading in progress.  Call this in loop(), e.g.
+  //  unsigned long wait = scheduler.run();  delay(min(wait, dht.poll()));
+  const unsigned long now = millis();
+  if (state == REQUEST) {
+    //  DHT11 needs the pin low for at least 18 milliseconds, DHT21 and DHT22 for 1 millisecond.
+    const unsigned long requestTime = (type == 11) ? 20 : 2;
+    if (now - stateTime < requestTime) return requestTime - (now - stateTime);
+    //  Release the pin and time the falling edges of the response.
+    activeReader = this;
+    pulseCount = 0;
+#ifdef ARDUINO
+    lastEdge = micros();
+    pinMode(pin, INPUT_PULLUP);
+  #ifdef EIFR
+    //  Driving the start pulse, and any edge since the last detachInterrupt(), set the interrupt
+    //  flag.  Clear it so that the handler doesn't run at once and count a pulse that isn't there.
+    //  On AVR, interrupt numbers 0 and 1 are the INTF0 and INTF1 bits.
+    EIFR = bit(digitalPinToInterrupt(pin));
+  #endif  //  EIFR
+    attachInterrupt(digitalPinToInterrupt(pin), handleInterrupt, FALLING);
+#endif  //  ARDUINO
+    state = CAPTURE;
+    stateTime = now;
+    return DHT_CAPTURE_TIMEOUT;
+  }
+  if (state == CAPTURE) {
+    if (pulseCount < DHT_PULSES && now - stateTime < DHT_CAPTURE_TIMEOUT) return 1;
+#ifdef ARDUINO
+    detachInterrupt(digitalPinToInterrupt(pin));
+#endif  //  ARDUINO
+    state = IDLE;
+    lastRead = now;
+    readBefore = true;
+    //  The interrupt is detached, so the pulses won't change while we decode them.
+    if (!decode((const uint8_t *) pulses, pulseCount)) { errorCount++; return DHT_IDLE; }
+    ready = true;
+    if (scheduler) {
+      if (temperatureField >= 0) scheduler->record(temperatureField, readTemperature());
+      if (humidityField >= 0) scheduler->record(humidityField, readHumidity());
+    }
+  }
+  return DHT_IDLE;
+}
+
+bool DHTReader::decode(const uint8_t timings[], uint8_t count) {
+  //  Decode the microseconds between falling edges, as captured by handleInterrupt().
+  //  Each bit is a 50-microsecond low followed by a high of 26 microseconds
+  //  for 0 or 70 microseconds for 1, so we look at the time between falling edges.
+  //  The 5 bytes are humidity, temperature and checksum, most significant bit first.
+  //  Returns false and keeps the last reading if the pulses are incomplete or the checksum is wrong.
+  if (count < DHT_PULSES) return false;  //  Timeout, sensor may be missing.
+  uint8_t bytes[5] = {0, 0, 0, 0, 0};
+  for (uint8_t i = 0; i < 40; i++) {
+    bytes[i / 8] <<= 1;
+    if (timings[FIRST_BIT + i] > PULSE_ONE) bytes[i / 8] |= 1;
+  }
+  if (((bytes[0] + bytes[1] + bytes[2] + bytes[3]) & 0xff) != bytes[4]) return false;  //  Bad checksum.
+  if (type == 11) {
+    //  DHT11 sends whole numbers in bytes 0 and 2, and tenths of a degree in byte 3.
+    humidity = bytes[0] * 10;
+    temperature = bytes[2] * 10 + (bytes[3] & 0x0f);
+  } else {
+    //  DHT21 and DHT22 send tenths.  The top bit of the temperature is the sign.
+    humidity = ((unsigned int) bytes[0] << 8) | bytes[1];
+    temperature = (int) ((((unsigned int) bytes[2] & 0x7f) << 8) | bytes[3]);
+    if (bytes[2] & 0x80) temperature = -temperature;
+  }
+  valid = true;
+  return true;
+}
+
+bool DHTReader::isReady() {
+  //  Return true if a new reading has been decoded since the last call.
+  const bool result = ready;
+  ready = false;
+  return result;
+}
+
+float DHTReader::readTemperature() {
+  //  Return the last temperature in degrees Celsius, or NAN if none.
+  if (!valid) return NAN;
+  return temperature / 10.0;
+}
+
+float DHTReader::readHumidity() {
+  //  Return the last relative humidity in percent, or NAN if none.
+  if (!valid) return NAN;
+  return humidity / 10.0;
+}
+
+unsigned int DHTReader::getErrorCount() { return errorCount; }
+
+void DHTReader::handleInterrupt() {
+  //  Called by the interrupt at each falling edge of the sensor pin.
+  //  Save the microseconds since the last edge.  Keep this short so SoftwareSerial is not delayed.
+  DHTReader *r = activeReader;
+  if (r == 0 || r->pulseCount >= DHT_PULSES) return;
+#ifdef ARDUINO
+  const unsigned long now = micros();
+  const unsigned long elapsed = now - r->lastEdge;
+  r->lastEdge = now;
+  r->pulses[r->pulseCount] = (elapsed > 0xff) ? 0xff : (uint8_t) elapsed;
+#endif  //  ARDUINO
+  r->pulseCount++;
+}
@@ -0,0 +1,58 @@
+//  Library for reading DHT11 / DHT22 temperature and humidity sensors without blocking.
+//  The DHT library reads the sensor with interrupts disabled for about 5 milliseconds, which
+//  corrupts the SoftwareSerial responses from the SIGFOX module.  Instead we time the pulses
+//  from the sensor with an interrupt and decode them later in poll().
+#ifndef UNABIZ_ARDUINO_DHTREADER_H
+#define UNABIZ_ARDUINO_DHTREADER_H
+
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+const uint8_t DHT_PULSES = 42;  //  Falling edges for a reading: response, start of data, then 40 bits.
+const unsigned long DHT_CAPTURE_TIMEOUT = 10;  //  Reading takes about 5 milliseconds.  Give up after 10.
+const unsigned long DHT_IDLE = 0xffffffff;  //  Returned by poll() when there is no reading in progress.
+
+//  Only one DHTReader may be reading at a time because the interrupt handler is shared.
+//  The sensor pin must support attachInterrupt(), e.g. D2 or D3 on Arduino Uno.
+class DHTReader
+{
+public:
+  DHTReader(uint8_t pin, uint8_t type);  //  type is 11 for DHT11, 21 for DHT21, 22 for DHT22.
+  bool begin();  //  Set up the pin.  Returns false if the pin doesn't support interrupts.
+  void setScheduler(Scheduler &scheduler, int temperatureField, int humidityField);  //  Record readings in these fields.
+  bool start();  //  Start a reading.  Returns false if a reading is in progress or the sensor was read too recently.
+  unsigned long poll();  //  Continue the reading.  Returns the milliseconds until poll() should be called again.
+  bool isReady();  //  Return true if a new reading has been decoded since the last call.
+  float readTemperature();  //  Return the last temperature in degrees Celsius, or NAN if none.
+  float readHumidity();  //  Return the last relative humidity in percent, or NAN if none.
+  unsigned int getErrorCount();  //  Return the number of failed readings, e.g. timeout or bad checksum.
+  bool decode(const uint8_t timings[], uint8_t count);  //  Decode count pulse timings into the temperature and humidity.  Returns false if invalid.
+  static void handleInterrupt();  //  Called by the interrupt at each falling edge of the sensor pin.
+
+private:
+
+  enum State { IDLE, REQUEST, CAPTURE };
+  uint8_t pin;  //  Sensor pin.
+  uint8_t type;  //  11, 21 or 22.
+  State state = IDLE;
+  unsigned long stateTime = 0;  //  Time we entered the state.
+  unsigned long lastRead = 0;  //  Time of the last reading, because the sensor can't be read too often.
+  bool readBefore = false;  //  True after the first reading.
+  bool ready = false;  //  True if a new reading has been decoded.
+  int temperature = 0;  //  Last temperature in tenths of a degree.
+  unsigned int humidity = 0;  //  Last humidity in tenths of a percent.
+  bool valid = false;  //  True if temperature and humidity are valid.
+  unsigned int errorCount = 0;  //  Number of failed readings.
+  Scheduler *scheduler = 0;  //  Scheduler to record the readings.
+  int temperatureField = -1, humidityField = -1;  //  Scheduler fields for the readings.
+  volatile uint8_t pulseCount = 0;  //  Number of falling edges captured.  Updated by the interrupt.
+  volatile uint8_t pulses[DHT_PULSES];  //  Microseconds between falling edges, up to 255.
+  volatile unsigned long lastEdge = 0;  //  Time of the last falling edge in microseconds.
+};
+
+#endif  //  UNABIZ_ARDUINO_DHTREADER_H
@@ -0,0 +1,110 @@
+//  Library for deciding which messages should request a downlink response.  Requesting a downlink
+//  makes the send wait up to a minute for the response, and the network allows only a few downlinks
+//  per day.  So we request only when a config change is pending or the last sync is too old,
+//  within a daily budget.  All other messages are sent without waiting.
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+#include "SIGFOX.h"
+
+DownlinkPolicy::DownlinkPolicy() {
+  dayStart = millis();
+}
+
+void DownlinkPolicy::setDailyBudget(uint8_t downlinks) {
+  //  Request up to this many downlinks per day.  Check your SIGFOX subscription for the limit.
+  budget = (downlinks > MAX_DOWNLINKS_PER_DAY) ? MAX_DOWNLINKS_PER_DAY : downlinks;
+}
+
+void DownlinkPolicy::setSyncInterval(unsigned long interval) {
+  //  Request a downlink if the last sync is older than this.
+  syncInterval = interval;
+}
+
+void DownlinkPolicy::setBatteryPolicy(BatteryPolicy &battery0) {
+  //  Stretch the sync interval as the battery drains, since each downlink costs a minute of receiving.
+  battery = &battery0;
+}
+
+void DownlinkPolicy::setHandler(DownlinkFunc handler0) {
+  //  Call this function with each downlink response.
+  handler = handler0;
+}
+
+void DownlinkPolicy::requestConfig() {
+  //  Request a downlink with the next message, e.g. when the server has a pending config change.
+  configPending = true;
+}
+
+void DownlinkPolicy::updateBudget(unsigned long now) {
+  //  Restore the budget every day.  Handles millis() overflow.
+  while (now - dayStart >= DOWNLINK_DAY) {
+    dayStart = dayStart + DOWNLINK_DAY;
+    used = 0;
+  }
+}
+
+bool DownlinkPolicy::shouldRequest() {
+  //  Return true if the next message should request a downlink:
+  //  a config change is pending, or we have never synced, or the last sync is too old.
+  //  Always false if the daily budget is used up.
+  const unsigned long now = millis();
+  updateBudget(now);
+  if (used >= budget) return false;
+  if (configPending || !synced) return true;
+  const unsigned long interval = battery ? battery->stretch(syncInterval) : syncInterval;
+  return now - lastSync >= interval;
+}
+
+bool DownlinkPolicy::send(Message &msg) {
+  //  Send the message, requesting a downlink if needed.
+  String response;
+  return send(msg, response);
+}
+
+bool DownlinkPolicy::send(Message &msg, String &response) {
+  //  Send the message, requesting a downlink if needed.  Otherwise send without waiting.
+  //  If a downlink is received, pass it to the handler.  Response is empty if there was no downlink.
+  response = "";
+  if (!shouldRequest()) return msg.send();
+  used++;  //  Counts against the budget even if no response comes.
+  if (!msg.sendAndGetResponse(response)) return false;
+  if (response.length() == 0) return true;  //  No downlink.  We will try again with the next message.
+  lastSync = millis();
+  synced = true;
+  configPending = false;
+  if (handler) handler(response);
+  return true;
+}
+
+uint8_t DownlinkPolicy::getRemaining() {
+  //  Return the number of downlinks left in the budget today.
+  updateBudget(millis());
+  return (used >= budget) ? 0 : budget - used;
+}
+
+unsigned long DownlinkPolicy::getLastSync() {
+  //  Return the millis() time of the last downlink received, or 0 if none.
+  return synced ? lastSync : 0;
+}
+
+int DownlinkPolicy::hexByte(const String &response, unsigned int pos) {
+  //  Return the byte at the hex digits response[pos], response[pos+1], or -1 if not hex.
+  //  Used by the downlink handlers to parse the response.
+  int result = 0;
+  for (unsigned int i = pos; i < pos + 2; i++) {
+    const char ch = response.charAt(i);
+    int digit;
+    if (ch >= '0' && ch <= '9') digit = ch - '0';
+    else if (ch >= 'a' && ch <= 'f') digit = ch - 'a' + 10;
+    else if (ch >= 'A' && ch <= 'F') digit = ch - 'A' + 10;
+    else return -1;
+    result = result * 16 + digit;
+  }
+  return result;
+}
@@ -0,0 +1,53 @@
+//  Library for deciding which messages should request a downlink response.  Requesting a downlink
+//  makes the send wait up to a minute for the response, and the network allows only a few downlinks
+//  per day.  So we request only when a config change is pending or the last sync is too old,
+//  within a daily budget.  All other messages are sent without waiting.
+#ifndef UNABIZ_ARDUINO_DOWNLINKPOLICY_H
+#define UNABIZ_ARDUINO_DOWNLINKPOLICY_H
+
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+const uint8_t MAX_DOWNLINKS_PER_DAY = 4;  //  SIGFOX allows up to 4 downlinks per day.
+const unsigned long DOWNLINK_DAY = (unsigned long) 24 * 60 * 60 * 1000;  //  Milliseconds per day.
+const unsigned long SYNC_INTERVAL = DOWNLINK_DAY;  //  Request a downlink at least once a day to sync.
+
+//  Function to handle the downlink response, 16 hex digits.
+typedef void (*DownlinkFunc)(const String &response);
+
+class DownlinkPolicy
+{
+public:
+  DownlinkPolicy();
+  void setDailyBudget(uint8_t downlinks);  //  Request up to this many downlinks per day.  Defaults to MAX_DOWNLINKS_PER_DAY.
+  void setSyncInterval(unsigned long interval);  //  Request a downlink if the last sync is older than this.  Defaults to SYNC_INTERVAL.
+  void setBatteryPolicy(BatteryPolicy &battery);  //  Stretch the sync interval as the battery drains.
+  void setHandler(DownlinkFunc handler);  //  Call this function with each downlink response.
+  void requestConfig();  //  Request a downlink with the next message, e.g. when the server has a pending config change.
+  bool shouldRequest();  //  Return true if the next message should request a downlink.
+  bool send(Message &msg);  //  Send the message, requesting a downlink if needed.
+  bool send(Message &msg, String &response);  //  Same as above, response is empty if no downlink was requested or received.
+  uint8_t getRemaining();  //  Return the number of downlinks left in the budget today.
+  unsigned long getLastSync();  //  Return the millis() time of the last downlink received, or 0 if none.
+  static int hexByte(const String &response, unsigned int pos);  //  Return the byte at the hex digits response[pos], or -1 if not hex.
+
+private:
+  void updateBudget(unsigned long now);  //  Restore the budget every day.
+
+  uint8_t budget = MAX_DOWNLINKS_PER_DAY;  //  Downlinks allowed per day.
+  uint8_t used = 0;  //  Downlinks requested today.
+  unsigned long dayStart = 0;  //  Start of the current budget day.
+  unsigned long syncInterval = SYNC_INTERVAL;  //  Request a downlink if the last sync is older than this.
+  unsigned long lastSync = 0;  //  Time of the last downlink received.
+  bool synced = false;  //  True after the first downlink received.
+  bool configPending = false;  //  True if a downlink was requested by requestConfig().
+  BatteryPolicy *battery = 0;  //  Battery policy that stretches the sync interval.
+  DownlinkFunc handler = 0;  //  Function to handle the downlink response.
+};
+
+#endif  //  UNABIZ_ARDUINO_DOWNLINKPOLICY_H
@@ -0,0 +1,119 @@
+//  Library for estimating the frames lost between the device and the server, from the sequence
+//  numbers added by Message::setSequence().  Runs on the server side, e.g. in a backend compiled
+//  from the same sources, or under Windows or Mac for testing.  Recommends the number of
+//  repetitions and the send interval, which may be sent to the device by downlink.
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+#include "SIGFOX.h"
+
+LossEstimator::LossEstimator() {}
+
+bool LossEstimator::record(uint16_t sequence, unsigned long receivedTime, unsigned long sentTime) {
+  //  Record a frame received with the sequence number.  Frames skipped by the number are counted
+  //  as lost, until they arrive late.  Returns false if the frame is a duplicate, e.g. a repeat
+  //  sent by Message::repeat(), which should be dropped.  sentTime is 0 if unknown, else the
+  //  time sent in the same clock as receivedTime, e.g. from the "age" field of SyncClock.
+  if (sequence >= SEQUENCE_WRAP) return false;
+  const uint16_t ahead = (sequence + SEQUENCE_WRAP - lastSequence) % SEQUENCE_WRAP;
+  const uint16_t behind = (lastSequence + SEQUENCE_WRAP - sequence) % SEQUENCE_WRAP;
+  if (started && behind < LATE_WINDOW) {
+    //  Duplicate, or a frame that we counted as lost arrived late.
+    const uint32_t bit = (uint32_t) 1 << behind;
+    if (receivedBits & bit) { duplicates++; return false; }
+    receivedBits |= bit;
+    if (lost > 0) lost--;
+    if (windowLost > 0) windowLost--;
+    windowReceived++;
+  } else if (started && ahead < SEQUENCE_WRAP / 2) {
+    //  Newer frame.  The numbers skipped were lost.
+    lost += ahead - 1;
+    addWindow(1, ahead - 1);
+    receivedBits = (ahead >= 32) ? 1 : (receivedBits << ahead) | 1;
+    lastSequence = sequence;
+  } else {
+    //  First frame, or the device restarted the numbering, e.g. EEPROM erased by a new sketch.
+    started = true;
+    addWindow(1, 0);
+    receivedBits = 1;
+    lastSequence = sequence;
+  }
+  received++;
+  if (sentTime != 0 && receivedTime >= sentTime) {
+    //  Average the latency over about 8 frames.
+    const unsigned long elapsed = receivedTime - sentTime;
+    latency = latencyKnown ? (unsigned long) ((long) latency + ((long) elapsed - (long) latency) / 8) : elapsed;
+    latencyKnown = true;
+  }
+  return true;
+}
+
+void LossEstimator::addWindow(uint16_t receivedCount, uint16_t lostCount) {
+  //  Count the frames received and lost.  When the window is full, halve the counts
+  //  so that the recent frames count more and the rate follows changes in coverage.
+  windowReceived += receivedCount;
+  windowLost += lostCount;
+  while (windowReceived + windowLost > LOSS_WINDOW) {
+    windowReceived = (windowReceived + 1) / 2;
+    windowLost = (windowLost + 1) / 2;
+  }
+}
+
+float LossEstimator::getLossRate() {
+  //  Return the fraction of frames lost recently, from 0 to 1.
+  const uint16_t total = windowReceived + windowLost;
+  if (total == 0) return 0;
+  return (float) windowLost / total;
+}
+
+unsigned long LossEstimator::getLatency() { return latency; }
+
+unsigned long LossEstimator::getReceived() { return received; }
+
+unsigned long LossEstimator::getLost() { return lost; }
+
+unsigned long LossEstimator::getDuplicates() { return duplicates; }
+
+uint8_t LossEstimator::getRepetitions(float targetLoss) {
+  //  Return the number of times each frame should be sent, up to MAX_REPETITIONS, so that at most
+  //  targetLoss of the samples are lost.  Assumes the repeats are lost independently, which is
+  //  why Scheduler spreads them between the sends.  Pass to Message::setRepetitions().
+  const float loss = getLossRate();
+  uint8_t repetitions = 1;
+  float samplesLost = loss;
+  while (samplesLost > targetLoss && repetitions < MAX_REPETITIONS) {
+    repetitions++;
+    samplesLost *= loss;
+  }
+  return repetitions;
+}
+
+unsigned long LossEstimator::getSendInterval(unsigned long targetInterval, uint8_t repetitions) {
+  //  Each sample is received with probability 1 - loss ^ repetitions.  To receive a sample every
+  //  targetInterval on average, send every targetInterval times that probability, but not so often
+  //  that the repeats break the duty cycle.  Pass to Scheduler::setSendInterval().
+  const float loss = getLossRate();
+  float samplesLost = 1;
+  for (uint8_t i = 0; i < repetitions; i++) samplesLost *= loss;
+  unsigned long interval = (unsigned long) (targetInterval * (1 - samplesLost));
+  const unsigned long minInterval = SEND_DELAY * (repetitions < 1 ? 1 : repetitions);
+  return (interval < minInterval) ? minInterval : interval;
+}
+
+String LossEstimator::getFeedback() {
+  //  Return the link feedback downlink with the loss rate in percent, for PowerControl::handleDownlink().
+  static const char digits[] = "0123456789abcdef";
+  const uint8_t feedback[] = { LINK_FEEDBACK_COMMAND, (uint8_t) (getLossRate() * 100 + 0.5) };
+  String result;
+  for (uint8_t i = 0; i < 8; i++) {
+    const uint8_t b = (i < sizeof(feedback)) ? feedback[i] : 0;
+    result.concat(digits[b >> 4]);
+    result.concat(digits[b & 15]);
+  }
+  return result;
+}
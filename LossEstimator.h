@@ -0,0 +1,48 @@
+//  Library for estimating the frames lost between the device and the server, from the sequence
+//  numbers added by Message::setSequence().  Runs on the server side, e.g. in a backend compiled
+//  from the same sources, or under Windows or Mac for testing.  Recommends the number of
+//  repetitions and the send interval, which may be sent to the device by downlink.
+#ifndef UNABIZ_ARDUINO_LOSSESTIMATOR_H
+#define UNABIZ_ARDUINO_LOSSESTIMATOR_H
+
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+const uint16_t LOSS_WINDOW = 256;  //  Loss rate is estimated over about the last 256 frames.
+const uint8_t LATE_WINDOW = 32;  //  Frames up to 32 numbers late are counted as received, not lost.
+
+class LossEstimator
+{
+public:
+  LossEstimator();
+  bool record(uint16_t sequence, unsigned long receivedTime, unsigned long sentTime = 0);  //  Record a frame received.  Returns false if duplicate.
+  float getLossRate();  //  Return the fraction of frames lost, from 0 to 1.
+  unsigned long getLatency();  //  Return the average milliseconds from sent to received, or 0 if unknown.
+  unsigned long getReceived();  //  Return the number of frames received, excluding duplicates.
+  unsigned long getLost();  //  Return the number of frames lost.
+  unsigned long getDuplicates();  //  Return the number of repeats and duplicates dropped.
+  uint8_t getRepetitions(float targetLoss);  //  Return the repetitions needed to lose at most targetLoss of the samples.
+  unsigned long getSendInterval(unsigned long targetInterval, uint8_t repetitions);  //  Return the send interval to receive a sample every targetInterval.
+  String getFeedback();  //  Return the link feedback downlink for PowerControl, 16 hex digits.
+
+private:
+  void addWindow(uint16_t received, uint16_t lost);  //  Add to the loss window, halving it when full.
+
+  bool started = false;  //  True after the first frame.
+  uint16_t lastSequence = 0;  //  Highest sequence number received.
+  uint32_t receivedBits = 0;  //  Bit i is set if lastSequence - i was received.
+  unsigned long received = 0;  //  Frames received.
+  unsigned long lost = 0;  //  Frames lost.
+  unsigned long duplicates = 0;  //  Frames dropped as duplicates.
+  uint16_t windowReceived = 0;  //  Frames received in the loss window.
+  uint16_t windowLost = 0;  //  Frames lost in the loss window.
+  unsigned long latency = 0;  //  Average latency in milliseconds.
+  bool latencyKnown = false;  //  True after the first frame with the sent time.
+};
+
+#endif  //  UNABIZ_ARDUINO_LOSSESTIMATOR_H
@@ -16,28 +16,43 @@
 //  27 = 0, 28 = 1, ..., 31 = 4
 //  5 to 9 cannot be encoded.
 
-static const uint8_t firstLetter = 1;
-static const uint8_t firstDigit = 27;
+//  The encoding is done by Message::encodeLetter() and Message::nameCode()
+//  in Message.h, so that names may be encoded at compile time.
 
-static uint8_t encodeLetter(char ch) {
-  //  Convert character ch to the 5-bit equivalent.
-  //  Convert to lowercase.
+//  With NAME_6BIT encoding, names that can't be encoded in 5 bits are
+//  encoded in 6 bits per letter.  The 5-bit codes are the same in 6 bits:
+//  0 = End of name/value or can't be encoded.
+//  1 = a, 2 = b, ..., 26 = z,
+//  27 = 0, 28 = 1, ..., 36 = 9,
+//  37 to 44 = _ - . + % / # *
+
+//  Lookup table for decoding each 5-bit or 6-bit code to the letter.  Replaces
+//  the range checks so that decoding a name takes 3 table lookups.
+static const uint8_t letterTableSize = 64;
+static const char letterTable[letterTableSize] = {
+  0,                                             //  0 = End of name
+  'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i',  //  1 to 26 = a to z
+  'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r',
+  's', 't', 'u', 'v', 'w', 'x', 'y', 'z',
+  '0', '1', '2', '3', '4',                       //  27 to 31 = 0 to 4
+  '5', '6', '7', '8', '9',                       //  6 bits only: 32 to 36 = 5 to 9
+  '_', '-', '.', '+', '%', '/', '#', '*',        //  6 bits only: 37 to 44
+};
+
+//  6-bit names are marked by the header bit, which is always 0 for 5-bit names.
+//  [1rrr] [0000] [0011] [1111] [rr22] [2222]
+static const unsigned int extendedNameFlag = 0x8000;
+
+static uint8_t encodeLetter6(char ch) {
+  //  Convert character ch to the 6-bit equivalent.
   if (ch >= 'A' && ch <= 'Z') ch = ch - 'A' + 'a';
-  if (ch >= 'a' && ch <= 'z') return ch - 'a' + firstLetter;
-  //  For 1, 2, ... return the digit
-  if (ch >= '0' && ch <= '4') return (ch - '0') + 27;
+  if (ch == 0) return 0;
+  for (uint8_t code = 1; code < letterTableSize; code++)
+    if (letterTable[code] == ch) return code;
   //  Can't encode.
   return 0;
 }
 
-static char decodeLetter(uint8_t code) {
-  //  Convert the 5-bit code to a letter.
-  if (code == 0) return 0;
-  if (code >= firstLetter && code < firstDigit) return code - firstLetter + 'a';
-  if (code >= firstDigit) return code - firstDigit + '0';
-  return 0;
-}
-
 static String doubleToString(double d) {
   //  Convert double to string, since Bean+ doesn't support double in Strings.
   //  Assume 1 decimal place.
@@ -45,6 +60,12 @@ static String doubleToString(double d) {
   return result;
 }
 
+static int scaleByTen(double value) {
+  //  Scale to 1 decimal place, rounded to the nearest.  Truncating would encode
+  //  579.3, which is stored as 579.29998, as 579.2.
+  return (int) (value * 10.0 + (value < 0 ? -0.5 : 0.5));
+}
+
 void Message::echo(String msg) {
   if (wisol) wisol->echo(msg);
   else if (radiocrafts) radiocrafts->echo(msg);
@@ -53,88 +74,225 @@ void Message::echo(String msg) {
 Message::Message(Radiocrafts &transceiver) {
   //  Construct a message for Radiocrafts.
   radiocrafts = &transceiver;
+  reserve(MAX_BYTES_PER_MESSAGE);
 }
 
 Message::Message(Wisol &transceiver) {
   //  Construct a message for Wisol.
   wisol = &transceiver;
+  reserve(MAX_BYTES_PER_MESSAGE);
+}
+
+bool Message::reserve(unsigned int bytes) {
+  //  Allocate the storage for an encoded message of the number of bytes, so that
+  //  the encoded message doesn't grow as fields are added.  Field names passed as
+  //  Strings and ECHO_FIELDS still create temporary Strings.
+  return encodedMessage.reserve(bytes * 2);
+}
+
+void Message::reset() {
+  //  Clear the fields so that the message may be reused.  Keeps the storage
+  //  allocated, so a long-lived message doesn't allocate its encoding again.
+  encodedMessage.remove(0);
+  addFailed = false;
+}
+
+void Message::setEchoMode(EchoMode mode) {
+  //  ECHO_FIELDS: Echo each field when added.  ECHO_SUMMARY: Echo all fields
+  //  in one line when sending.  ECHO_NONE: Don't echo the fields.
+  echoMode = mode;
+}
+
+//  Convert nibble to hex digit.
+static const char hexDigits[] = "0123456789abcdef";
+
+void Message::addHex(unsigned int value, uint8_t bytes) {
+  //  Append the value as hex digits, LSB first, same as toHex() for the transceiver.
+  //  Doesn't create temporary Strings, so no memory is allocated.
+  for (uint8_t i = 0; i < bytes; i++) {
+    uint8_t b = (uint8_t) (value >> (8 * i));
+    encodedMessage.concat(hexDigits[b >> 4]);
+    encodedMessage.concat(hexDigits[b & 15]);
+  }
 }
 
 //  TODO: Move these messages to Flash memory.
 static String addFieldHeader = "Message.addField: ";
 static String tooLong = "****ERROR: Message too long, already ";
 
+static unsigned int encodeName(const String &name) {
+  //  Encode the 3-letter name into 15 bits.  Same as Message::nameCode() but for Strings.
+  unsigned int result = 0;
+  for (unsigned int i = 0; i <= 2; i++) {
+    //  5 bits for each letter.  Unused letters are encoded as 0.
+    char ch = (i < name.length()) ? name.charAt(i) : 0;
+    result = (result << 5) + Message::encodeLetter(ch);
+  }
+  return result;
+}
+
 bool Message::addField(const String name, int value) {
   //  Add an integer field scaled by 10.  2 bytes.
-  echo(addFieldHeader + name + '=' + value);
+  if (echoMode == ECHO_FIELDS) echo(addFieldHeader + name + '=' + value);
   int val = value * 10;
   return addIntField(name, val);
 }
 
 bool Message::addField(const String name, float value) {
   //  Add a float field with 1 decimal place.  2 bytes.
-  echo(addFieldHeader + name + '=' + doubleToString(value));
-  int val = (int) (value * 10.0);
+  if (echoMode == ECHO_FIELDS) echo(addFieldHeader + name + '=' + doubleToString(value));
+  int val = scaleByTen(value);
   return addIntField(name, val);
 }
 
 bool Message::addField(const String name, double value) {
   //  Add a double field with 1 decimal place.  2 bytes.
-  echo(addFieldHeader + name + '=' + doubleToString(value));
-  int val = (int) (value * 10.0);
+  if (echoMode == ECHO_FIELDS) echo(addFieldHeader + name + '=' + doubleToString(value));
+  int val = scaleByTen(value);
   return addIntField(name, val);
 }
 
-bool Message::addIntField(const String name, int value) {
-  //  Add an int field that is already scaled.  2 bytes for name, 2 bytes for value.
-  if (encodedMessage.length() + (4 * 2) > MAX_BYTES_PER_MESSAGE * 2) {
-    echo(tooLong + (encodedMessage.length() / 2) + " bytes");
-    return false;
+bool Message::addField(unsigned int nameCode, int value) {
+  //  Add an integer field scaled by 10.  Name was encoded by Message::nameCode().
+  if (echoMode == ECHO_FIELDS) {
+    char name[4]; decodeName(nameCode, name);
+    echo(addFieldHeader + name + '=' + value);
   }
+  int val = value * 10;
+  return addIntField(nameCode, val);
+}
+
+bool Message::addField(unsigned int nameCode, float value) {
+  //  Add a float field with 1 decimal place.  Name was encoded by Message::nameCode().
+  if (echoMode == ECHO_FIELDS) {
+    char name[4]; decodeName(nameCode, name);
+    echo(addFieldHeader + name + '=' + doubleToString(value));
+  }
+  int val = scaleByTen(value);
+  return addIntField(nameCode, val);
+}
+
+bool Message::addField(unsigned int nameCode, double value) {
+  //  Add a double field with 1 decimal place.  Name was encoded by Message::nameCode().
+  if (echoMode == ECHO_FIELDS) {
+    char name[4]; decodeName(nameCode, name);
+    echo(addFieldHeader + name + '=' + doubleToString(value));
+  }
+  int val = scaleByTen(value);
+  return addIntField(nameCode, val);
+}
+
+bool Message::addIntField(const String name, int value) {
+  //  Add an int field that is already scaled.  2 or 3 bytes for name, 2 bytes for value.
+  if (!checkLength(nameLength(name) + 2)) return false;
   addName(name);
-  if (wisol) encodedMessage.concat(wisol->toHex(value));
-  else if (radiocrafts) encodedMessage.concat(radiocrafts->toHex(value));
+  addHex((unsigned int) value, 2);
+  return true;
+}
+
+bool Message::addIntField(unsigned int nameCode, int value) {
+  //  Add an int field that is already scaled.  2 bytes for name, 2 bytes for value.
+  if (!checkLength(4)) return false;
+  addNameCode(nameCode);
+  addHex((unsigned int) value, 2);
   return true;
 }
 
 bool Message::addField(const String name, const String value) {
-  //  Add a string field with max 3 chars.  2 bytes for name, 2 bytes for value.
-  echo(addFieldHeader + name + '=' + value);
-  if (encodedMessage.length() + (4 * 2) > MAX_BYTES_PER_MESSAGE * 2) {
+  //  Add a string field with max 3 chars.  2 or 3 bytes for name, 2 bytes for value.
+  //  The value is always encoded in 5 bits, because decodeMessage() reads 2 bytes after
+  //  the name.  Letters that need 6 bits are encoded as 0.
+  if (echoMode == ECHO_FIELDS) echo(addFieldHeader + name + '=' + value);
+  if (!checkLength(nameLength(name) + 2)) return false;
+  addName(name);
+  addNameCode(encodeName(value));
+  return true;
+}
+
+bool Message::checkLength(uint8_t bytes) {
+  //  Return true if we can add the number of bytes to the message.
+  if (bytes > getCapacity()) {
     echo(tooLong + (encodedMessage.length() / 2) + " bytes");
     return false;
   }
-  addName(name);
-  addName(value);
   return true;
 }
 
+uint8_t Message::getCapacity() {
+  //  Return the number of bytes that may still be added.  While sequencing is on, the space
+  //  for "seq" is kept free so that a full message fails when adding the fields, not when sending.
+  const uint8_t used = encodedMessage.length() / 2 + (sequenceEnabled ? SEQUENCE_BYTES : 0);
+  return (used >= MAX_BYTES_PER_MESSAGE) ? 0 : MAX_BYTES_PER_MESSAGE - used;
+}
+
+void Message::setNameEncoding(NameEncoding encoding) {
+  //  With NAME_6BIT, names that can't be encoded in 5 bits will be encoded
+  //  in 6 bits and take 3 bytes instead of 2.  Other names still take 2 bytes.
+  nameEncoding = encoding;
+}
+
+static bool isExtendedName(const String &name) {
+  //  Return true if the name can't be encoded in 5 bits but can be encoded in 6 bits.
+  for (unsigned int i = 0; i <= 2 && i < name.length(); i++) {
+    char ch = name.charAt(i);
+    if (Message::encodeLetter(ch) == 0) return encodeLetter6(ch) != 0;
+  }
+  return false;
+}
+
+uint8_t Message::nameLength(const String &name) {
+  //  Return the number of bytes needed to encode the name.
+  if (nameEncoding == NAME_6BIT && isExtendedName(name)) return 3;
+  return 2;
+}
+
 bool Message::addName(const String name) {
   //  Add the encoded field name with 3 letters.
-  //  1 header bit + 5 bits for each letter, total 16 bits.
   //  TODO: Assert name has 3 letters.
-  //  TODO: Assert encodedMessage is less than 12 bytes.
-  //  Convert 3 letters to 3 bytes.
+  if (nameLength(name) == 2) return addNameCode(encodeName(name));
+  //  Encode in 6 bits: 2 bytes for the header bit and first 2 letters, 1 byte for the last letter.
   uint8_t buffer[] = {0, 0, 0};
-  for (int i = 0; i <= 2 && i <= name.length(); i++) {
-    //  5 bits for each letter.
-    char ch = name.charAt(i);
-    buffer[i] = encodeLetter(ch);
+  for (unsigned int i = 0; i <= 2 && i < name.length(); i++) {
+    buffer[i] = encodeLetter6(name.charAt(i));
+    if (buffer[i] == 0) break;  //  Name ends at the first letter that can't be encoded.
   }
+  unsigned int result = extendedNameFlag + (buffer[0] << 6) + buffer[1];
+  addHex(result, 2);
+  addHex(buffer[2], 1);
+  return true;
+}
+
+bool Message::addNameCode(unsigned int nameCode) {
+  //  Add the encoded field name with 3 letters.
+  //  1 header bit + 5 bits for each letter, total 16 bits.
   //  [x000] [0011] [1112] [2222]
   //  [x012] [3401] [2340] [1234]
-  unsigned int result =
-      (buffer[0] << 10) +
-      (buffer[1] << 5) +
-      (buffer[2]);
-  if (wisol) encodedMessage.concat(wisol->toHex(result));
-  else if (radiocrafts) encodedMessage.concat(radiocrafts->toHex(result));
+  //  TODO: Assert encodedMessage is less than 12 bytes.
+  addHex(nameCode, 2);
   return true;
 }
 
-bool Message::send() {
-  //  Send the encoded message to SIGFOX.
-  String msg = getEncodedMessage();
+int Message::toTenths(float value) {
+  //  Scale the value by 10, rounded and limited to 16 bits.  Used for storing
+  //  values with the same precision as the fields sent.
+  float tenths = value * 10.0f + (value < 0 ? -0.5f : 0.5f);
+  if (tenths > 32767) return 32767;
+  if (tenths < -32767) return -32767;
+  return (int) tenths;
+}
+
+void Message::decodeName(unsigned int nameCode, char name[4]) {
+  //  Decode the 15-bit name code into 3 letters, terminated by 0.
+  //  Each letter is a single table lookup.
+  name[0] = letterTable[(nameCode >> 10) & 31];
+  name[1] = letterTable[(nameCode >> 5) & 31];
+  name[2] = letterTable[nameCode & 31];
+  name[3] = 0;
+}
+
+bool Message::checkSend() {
+  //  Return true if the message is OK to be sent.  Echo the fields if batched.
+  const String &msg = encodedMessage;  //  Don't copy the message.
   if (msg.length() == 0) {
     echo("****ERROR: Nothing to send");  //  TODO: Move to Flash.
     return false;
@@ -143,25 +301,110 @@ bool Message::send() {
     echo(tooLong + (encodedMessage.length() / 2) + " bytes");
     return false;
   }
-  if (wisol) return wisol->sendMessage(msg);
-  else if (radiocrafts) return radiocrafts->sendMessage(msg);
-  return false;
+  if (addFailed) {
+    echo("****ERROR: Not sent because add() failed");  //  TODO: Move to Flash.
+    return false;
+  }
+  //  Echo all fields in one line.
+  if (echoMode == ECHO_SUMMARY) echo(String("Message.send: ") + decodeMessage(msg));
+  return true;
+}
+
+bool Message::send() {
+  //  Send the encoded message to SIGFOX.
+  return sendFrame(0);
 }
 
 bool Message::sendAndGetResponse(String &response) {
   //  Send the structured message and get the downlink response.
-  String msg = getEncodedMessage();
-  if (msg.length() == 0) {
-    echo("****ERROR: Nothing to send");  //  TODO: Move to Flash.
-    return false;
+  return sendFrame(&response);
+}
+
+bool Message::sendFrame(String *response) {
+  //  Add the sequence number, send the frame, then remove the sequence number so that
+  //  the message may be sent again with the next number.  The number is counted only
+  //  if the frame was sent, so a gap in the numbers received means frames were lost.
+  const unsigned int length = encodedMessage.length();
+  const bool sent = addSequence() && checkSend() && transmit(encodedMessage, response);
+  if (sent) {
+    if (repetitions > 1) lastFrame = encodedMessage;
+    repeatsPending = repetitions - 1;
+    if (sequenceEnabled) saveSequence((getSequence() + 1) % SEQUENCE_WRAP);
   }
-  if (msg.length() > MAX_BYTES_PER_MESSAGE * 2) {
+  encodedMessage.remove(length);
+  return sent;
+}
+
+bool Message::transmit(const String &msg, String *response) {
+  //  Send the encoded frame, and get the downlink response if response is not 0.
+  if (wisol) return response ? wisol->sendMessageAndGetResponse(msg, *response) : wisol->sendMessage(msg);
+  else if (radiocrafts) return radiocrafts->sendMessage(msg);
+  return false;
+}
+
+bool Message::setSequence(bool enable) {
+  //  Add the field "seq" to every frame sent, so that the server can count the frames lost.
+  //  The number is saved in EEPROM so it continues after a reset instead of restarting from 0.
+  //  Returns false and leaves sequencing off if the fields already added leave no space for "seq".
+  if (enable && !sequenceEnabled && encodedMessage.length() / 2 + SEQUENCE_BYTES > MAX_BYTES_PER_MESSAGE) {
     echo(tooLong + (encodedMessage.length() / 2) + " bytes");
     return false;
   }
-  if (wisol) return wisol->sendMessageAndGetResponse(msg, response);
-  else if (radiocrafts) return radiocrafts->sendMessage(msg);
-  return false;
+  sequenceEnabled = enable;
+  return true;
+}
+
+void Message::setRepetitions(uint8_t count) {
+  //  Send each frame count times, from 1 to MAX_REPETITIONS.  The repeats have the same
+  //  sequence number so the server can drop the duplicates.  The transceiver already sends
+  //  each frame 3 times within seconds, so repeats minutes apart survive longer interference.
+  if (count < 1) count = 1;
+  if (count > MAX_REPETITIONS) count = MAX_REPETITIONS;
+  repetitions = count;
+  if (repetitions > 1) lastFrame.reserve(MAX_BYTES_PER_MESSAGE * 2);
+  if (repeatsPending >= repetitions) repeatsPending = repetitions - 1;
+}
+
+bool Message::repeat() {
+  //  Send the last frame again.  Call this after a delay, e.g. Scheduler spreads the repeats
+  //  between the sends.  Returns false if no repeats are pending or the send failed.
+  if (repeatsPending == 0) return false;
+  if (!transmit(lastFrame, 0)) return false;
+  repeatsPending--;
+  return true;
+}
+
+uint8_t Message::getRepeatsPending() { return repeatsPending; }
+
+bool Message::isSequenced() { return sequenceEnabled; }
+
+bool Message::addSequence() {
+  //  Add the sequence number as an integer field.  Always fits, because the space is reserved.
+  if (!sequenceEnabled) return true;
+  const int sequence = (int) getSequence();
+  if (echoMode == ECHO_FIELDS) echo(addFieldHeader + "seq=" + sequence);
+  //  Fill the space reserved by getCapacity().
+  addNameCode(nameCode("seq"));
+  addHex((unsigned int) (sequence * 10), 2);
+  return true;
+}
+
+uint16_t Message::getSequence() {
+  //  Number n is saved in slot n % SEQUENCE_SLOTS, so each slot is written once every 16 frames.
+  //  The newest slot is the one not followed by the next number.  Erased slots read as 0xffff.
+  for (uint8_t slot = 0; slot < SEQUENCE_SLOTS; slot++) {
+    const uint16_t number = Storage::readWord(EEPROM_SEQUENCE + slot * 2);
+    if (number >= SEQUENCE_WRAP) continue;  //  Erased.
+    const uint16_t following = Storage::readWord(EEPROM_SEQUENCE + ((slot + 1) % SEQUENCE_SLOTS) * 2);
+    if (following != (number + 1) % SEQUENCE_WRAP) return number;
+  }
+  return 0;  //  Never saved.
+}
+
+void Message::saveSequence(uint16_t sequence) {
+  //  Save the sequence number of the next frame in its slot.  SEQUENCE_WRAP is a multiple of
+  //  SEQUENCE_SLOTS, so the slots stay in order when the number restarts from 0.
+  Storage::writeWord(EEPROM_SEQUENCE + (sequence % SEQUENCE_SLOTS) * 2, sequence);
 }
 
 String Message::getEncodedMessage() {
@@ -180,35 +423,48 @@ static uint8_t hexDigitToDecimal(char ch) {
 String Message::decodeMessage(String msg) {
   //  Decode the encoded message.
   //  2 bytes name, 2 bytes float * 10, 2 bytes name, 2 bytes float * 10, ...
+  //  6-bit names take 3 bytes instead of 2.
   String result = "{";
-  for (int i = 0; i < msg.length(); i = i + 8) {
+  for (unsigned int i = 0; i + 8 <= msg.length(); i = i + 8) {
     String name = msg.substring(i, i + 4);
-    String val = msg.substring(i + 4, i + 8);
     unsigned long name2 =
       (hexDigitToDecimal(name.charAt(2)) << 12) +
       (hexDigitToDecimal(name.charAt(3)) << 8) +
       (hexDigitToDecimal(name.charAt(0)) << 4) +
       hexDigitToDecimal(name.charAt(1));
+    //  Decode name.
+    char name3[4];
+    if (name2 & extendedNameFlag) {
+      //  6-bit name has 1 more byte for the last letter.
+      if (i + 10 > msg.length()) break;
+      uint8_t last =
+        (hexDigitToDecimal(msg.charAt(i + 4)) << 4) +
+        hexDigitToDecimal(msg.charAt(i + 5));
+      name3[0] = letterTable[(name2 >> 6) & 63];
+      name3[1] = letterTable[name2 & 63];
+      name3[2] = letterTable[last & 63];
+      name3[3] = 0;
+      i = i + 2;
+    } else {
+      decodeName((unsigned int) name2, name3);
+    }
+    String val = msg.substring(i + 4, i + 8);
     unsigned long val2 =
       (hexDigitToDecimal(val.charAt(2)) << 12) +
       (hexDigitToDecimal(val.charAt(3)) << 8) +
       (hexDigitToDecimal(val.charAt(0)) << 4) +
       hexDigitToDecimal(val.charAt(1));
-    if (i > 0) result.concat(',');
+    if (result.length() > 1) result.concat(',');
     result.concat('"');
-    //  Decode name.
-    char name3[] = {0, 0, 0, 0};
-    for (int j = 0; j < 3; j++) {
-      uint8_t code = name2 & 31;
-      char ch = decodeLetter(code);
-      if (ch > 0) name3[2 - j] = ch;
-      name2 = name2 >> 5;
-    }
-    name3[3] = 0;
     result.concat(name3);
     //  Decode value.
-    result.concat("\":"); result.concat((int)(val2 / 10));
-    result.concat('.'); result.concat((int)(val2 % 10));
+    //  Value is a signed 16-bit int, scaled by 10.  Use a long so that
+    //  -32768 can be negated on Arduino, where int has 16 bits.
+    long val3 = (int16_t) val2;
+    result.concat("\":");
+    if (val3 < 0) { result.concat('-'); val3 = -val3; }
+    result.concat(val3 / 10);
+    result.concat('.'); result.concat(val3 % 10);
   }
   result.concat('}');
   return result;
@@ -10,6 +10,27 @@
   #endif  //  ARDUINO  >= 100
 #endif  //  ARDUINO
 
+//  Encoding for the field names.
+enum NameEncoding {
+  NAME_5BIT = 0,  //  a-z, 0-4 in 5 bits per letter.  Name takes 2 bytes.
+  NAME_6BIT = 1,  //  Also allow 5-9 and symbols in 6 bits per letter.  Such names take 3 bytes.
+};
+
+//  Sequence numbers added by setSequence() count from 0 to SEQUENCE_WRAP - 1, then restart from 0.
+//  Each number is sent as the integer field "seq", which must fit 16 bits after scaling by 10.
+//  The field is reserved while sequencing is on, so a message then holds 8 bytes of other fields.
+const uint16_t SEQUENCE_WRAP = 3200;
+const uint8_t SEQUENCE_BYTES = 4;  //  Bytes taken by the field "seq".
+const uint8_t SEQUENCE_SLOTS = 16;  //  The sequence number is saved in one of 16 EEPROM slots in turn, to reduce wear.
+const uint8_t MAX_REPETITIONS = 3;  //  Max number of times each frame may be sent.
+
+//  How the fields are echoed.
+enum EchoMode {
+  ECHO_FIELDS = 0,  //  Echo each field when added.
+  ECHO_SUMMARY = 1,  //  Echo all fields in one line when sending.
+  ECHO_NONE = 2,  //  Don't echo the fields.
+};
+
 class Message
 {
 public:
@@ -19,16 +40,75 @@ public:
   bool addField(const String name, float value);  //  Add a float field with 1 decimal place.
   bool addField(const String name, double value);  //  Add a double field with 1 decimal place.
   bool addField(const String name, const String value);  //  Add a string field with max 3 chars.
+  bool addField(unsigned int nameCode, int value);  //  Add an integer field scaled by 10, name already encoded.
+  bool addField(unsigned int nameCode, float value);  //  Add a float field with 1 decimal place, name already encoded.
+  bool addField(unsigned int nameCode, double value);  //  Add a double field with 1 decimal place, name already encoded.
+  void setNameEncoding(NameEncoding encoding);  //  Allow 6-bit names like "pm5" for this message.
+  void reset();  //  Clear the fields so the message can be reused, keeping the storage.
+  void setEchoMode(EchoMode mode);  //  Echo each field, all fields when sending, or none.
+  bool setSequence(bool enable);  //  Add the field "seq" to every frame sent, counting the frames.  Returns false if the fields leave no space.
+  bool isSequenced();  //  Return true if the field "seq" is added to every frame.
+  uint8_t getCapacity();  //  Return the number of bytes that may still be added, excluding the space reserved for "seq".
+  void setRepetitions(uint8_t count);  //  Send each frame count times.  The repeats are sent later by repeat().
+  bool repeat();  //  Send the last frame again with the same sequence number.  Returns false if no repeats are pending.
+  uint8_t getRepeatsPending();  //  Return the number of repeats of the last frame not sent yet.
+  static uint16_t getSequence();  //  Return the sequence number of the next frame.  Saved in EEPROM.
+  bool reserve(unsigned int bytes);  //  Allocate storage for the number of bytes.  Done by the constructor.
   bool send();  //  Send the structured message.
   bool sendAndGetResponse(String &response);  //  Send the structured message and get the downlink response.
   String getEncodedMessage();  //  Return the encoded message to be transmitted.
   static String decodeMessage(String msg);  //  Decode the encoded message.
+  static void decodeName(unsigned int nameCode, char name[4]);  //  Decode the 3-letter name into name[].
+  static int toTenths(float value);  //  Scale the value by 10, rounded and limited to 16 bits.
+
+  //  Chainable versions of addField(), e.g. msg.add("ctr", 1).add("tmp", 2.3).send()
+  //  If any field can't be added, send() will fail.
+  Message &add(const String name, int value) { if (!addField(name, value)) addFailed = true; return *this; }
+  Message &add(const String name, float value) { if (!addField(name, value)) addFailed = true; return *this; }
+  Message &add(const String name, double value) { if (!addField(name, value)) addFailed = true; return *this; }
+  Message &add(unsigned int nameCode, int value) { if (!addField(nameCode, value)) addFailed = true; return *this; }
+  Message &add(unsigned int nameCode, float value) { if (!addField(nameCode, value)) addFailed = true; return *this; }
+  Message &add(unsigned int nameCode, double value) { if (!addField(nameCode, value)) addFailed = true; return *this; }
+
+  //  Encode the 3-letter name at compile time, e.g. Message::nameCode("tmp").
+  //  Pass the code to addField() to skip the encoding at runtime.
+  static constexpr unsigned int nameCode(const char *name) {
+    return (name[0] == 0) ? 0 :
+      (encodeLetter(name[0]) << 10) + ((name[1] == 0) ? 0 :
+      (encodeLetter(name[1]) << 5) + ((name[2] == 0) ? 0 :
+      encodeLetter(name[2])));
+  }
+
+  //  Convert character ch to the 5-bit equivalent.  See Message.cpp.
+  static constexpr uint8_t encodeLetter(char ch) {
+    return (ch >= 'A' && ch <= 'Z') ? ch - 'A' + 1 :
+      (ch >= 'a' && ch <= 'z') ? ch - 'a' + 1 :
+      (ch >= '0' && ch <= '4') ? ch - '0' + 27 :
+      0;
+  }
 
 private:
   bool addIntField(const String name, int value);  //  Add an integer field already scaled.
+  bool addIntField(unsigned int nameCode, int value);  //  Add an integer field already scaled, name already encoded.
   bool addName(const String name);  //  Encode and add the 3-letter name.
+  bool addNameCode(unsigned int nameCode);  //  Add the encoded 3-letter name.
+  uint8_t nameLength(const String &name);  //  Return the number of bytes needed to encode the name.
+  bool checkLength(uint8_t bytes);  //  Return true if we can add the number of bytes.
+  void addHex(unsigned int value, uint8_t bytes);  //  Append the bytes of the value as hex digits.
+  bool checkSend();  //  Return true if the message is OK to be sent.
+  bool addSequence();  //  Add the sequence number if enabled, into the space reserved by getCapacity().
+  bool sendFrame(String *response);  //  Send the message with the sequence number, and get the response if not 0.
+  bool transmit(const String &msg, String *response);  //  Send the encoded frame, and get the response if not 0.
+  static void saveSequence(uint16_t sequence);  //  Save the sequence number of the next frame in EEPROM.
   void echo(String msg);
   String encodedMessage;  //  Encoded message.
+  NameEncoding nameEncoding = NAME_5BIT;  //  Encoding for the field names.
+  EchoMode echoMode = ECHO_FIELDS;  //  How the fields are echoed.
+  bool addFailed = false;  //  True if add() failed to add a field.
+  bool sequenceEnabled = false;  //  True if the sequence number is added to every frame.
+  uint8_t repetitions = 1;  //  Number of times each frame is sent.
+  uint8_t repeatsPending = 0;  //  Number of repeats of the last frame not sent yet.
+  String lastFrame;  //  Last frame sent, including the sequence number, for repeat().
   Radiocrafts *radiocrafts = 0;  //  Reference to Radiocrafts transceiver for sending the message.
   Wisol *wisol = 0;  //  Reference to Wisol transceiver for sending the message.
 };
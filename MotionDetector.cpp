@@ -0,0 +1,155 @@
+//  Library for detecting motion, tilt and shock events from accelerometer samples,
+//  so that we send SIGFOX messages only when something happens.  Uses integer math only.
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+#include "SIGFOX.h"
+
+static const uint8_t GRAVITY_SHIFT = 3;  //  Gravity filter follows 1/8 of each new sample.
+static const uint8_t ENERGY_SHIFT = 8;  //  Motion energy is scaled down by 256 to fit 16 bits.
+static const unsigned int DEFAULT_MOTION = 50;  //  Default motion threshold in milli-g.
+static const unsigned int DEFAULT_SHOCK = 1500;  //  Default shock threshold in milli-g.  Each axis clips at 2 g in the 2G range.
+
+MotionDetector::MotionDetector(int countsPerG0) {
+  //  countsPerG0 is the raw reading for 1 g, e.g. 4096 for MMA8451 in the 2G range.
+  countsPerG = countsPerG0;
+  for (uint8_t i = 0; i < MOTION_WINDOW; i++) energy[i] = 0;
+  setMotionThreshold(DEFAULT_MOTION);
+  setShockThreshold(DEFAULT_SHOCK);
+}
+
+uint8_t MotionDetector::update(int x, int y, int z) {
+  //  Add a raw sample from the accelerometer.  Returns the MotionEvent flags detected by this sample.
+  const long sample[3] = {x, y, z};
+  if (sampleCount == 0) {
+    //  Start the gravity filter at the first sample so we don't see motion while it settles.
+    for (uint8_t i = 0; i < 3; i++) gravity[i] = sample[i] * 16;
+  }
+  //  Magnitude of the acceleration.  Deviation from 1 g is a shock.
+  unsigned long sumSquares = 0;
+  for (uint8_t i = 0; i < 3; i++) sumSquares += (unsigned long) (sample[i] * sample[i]);
+  magnitude = isqrt(sumSquares);
+  long deviation = (long) magnitude - countsPerG;
+  if (deviation < 0) deviation = -deviation;
+  if ((unsigned long) deviation > peak) peak = (unsigned int) deviation;
+
+  //  High-pass filter: remove the slowly-changing gravity to get the motion.
+  unsigned long sampleEnergy = 0;
+  for (uint8_t i = 0; i < 3; i++) {
+    gravity[i] += ((sample[i] * 16) - gravity[i]) >> GRAVITY_SHIFT;
+    long motion = sample[i] - (gravity[i] >> 4);
+    sampleEnergy += (unsigned long) (motion * motion);
+  }
+  sampleEnergy = sampleEnergy >> ENERGY_SHIFT;
+  if (sampleEnergy > 0xffff) sampleEnergy = 0xffff;
+
+  //  Replace the oldest sample in the window.
+  energySum = energySum - energy[index] + sampleEnergy;
+  energy[index] = (uint16_t) sampleEnergy;
+  index = (index + 1) & (MOTION_WINDOW - 1);
+  if (sampleCount < MOTION_WINDOW) sampleCount++;
+
+  uint8_t detected = 0;
+  if (sampleCount >= MOTION_WINDOW) {
+    //  Report motion when the window energy goes above the threshold, and stop when it
+    //  drops below half, so that we don't report on and off repeatedly near the threshold.
+    if (!moving && energySum > motionThreshold) { moving = true; detected |= MOTION_EVENT; }
+    else if (moving && energySum < motionThreshold / 2) { moving = false; detected |= STILL_EVENT; }
+  }
+  //  Report each shock once, until the deviation drops below half the threshold.
+  if (!shocked && (unsigned long) deviation > shockThreshold) { shocked = true; detected |= SHOCK_EVENT; }
+  else if (shocked && (unsigned long) deviation < shockThreshold / 2) shocked = false;
+
+  //  Orientation must be stable for the whole window before we report a tilt.
+  Orientation current = orientationOf(gravity[0], gravity[1], gravity[2]);
+  if (current != newOrientation) { newOrientation = current; stableCount = 0; }
+  else if (stableCount < MOTION_WINDOW) stableCount++;
+  if (stableCount >= MOTION_WINDOW && newOrientation != ORIENTATION_UNKNOWN
+      && newOrientation != orientation) {
+    if (orientation != ORIENTATION_UNKNOWN) detected |= TILT_EVENT;
+    orientation = newOrientation;
+  }
+  events |= detected;
+  return detected;
+}
+
+Orientation MotionDetector::orientationOf(long gx, long gy, long gz) {
+  //  Return the orientation for the gravity vector, by the axis nearest to vertical.
+  //  Return ORIENTATION_UNKNOWN if no axis is within about 45 degrees of vertical.
+  const long g[3] = {gx >> 4, gy >> 4, gz >> 4};
+  uint8_t axis = 0;
+  long largest = 0;
+  for (uint8_t i = 0; i < 3; i++) {
+    long a = g[i] < 0 ? -g[i] : g[i];
+    if (a > largest) { largest = a; axis = i; }
+  }
+  if (largest * 10 < (long) countsPerG * 7) return ORIENTATION_UNKNOWN;
+  return (Orientation) (ORIENTATION_X_UP + axis * 2 + (g[axis] < 0 ? 1 : 0));
+}
+
+unsigned int MotionDetector::isqrt(unsigned long n) {
+  //  Integer square root, bit by bit.  Returns the largest r such that r * r <= n.
+  unsigned long root = 0, bit = 1UL << 30;
+  while (bit > n) bit >>= 2;
+  while (bit != 0) {
+    if (n >= root + bit) {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    } else root >>= 1;
+    bit >>= 2;
+  }
+  return (unsigned int) root;
+}
+
+unsigned long MotionDetector::energyThreshold(unsigned int milliG) {
+  //  Convert the milli-g motion threshold to the window energy that update() computes.
+  unsigned long counts = (unsigned long) milliG * countsPerG / 1000;
+  return ((counts * counts) >> ENERGY_SHIFT) * MOTION_WINDOW;
+}
+
+void MotionDetector::setMotionThreshold(unsigned int milliG) {
+  //  Moving if the motion, after removing gravity, averages above this over the window.
+  motionThreshold = energyThreshold(milliG);
+}
+
+void MotionDetector::setShockThreshold(unsigned int milliG) {
+  //  Shock if the acceleration deviates from 1 g by this.  In the 2G range each axis
+  //  clips at 2 g, so a shock on one axis deviates by 1000 milli-g at most: use 800 or less.
+  shockThreshold = (unsigned int) ((unsigned long) milliG * countsPerG / 1000);
+}
+
+uint8_t MotionDetector::getEvents() { return events; }
+
+void MotionDetector::clearEvents() {
+  //  Clear the events and the shock peak, e.g. after sending them.
+  events = 0;
+  peak = 0;
+}
+
+bool MotionDetector::isMoving() { return moving; }
+
+Orientation MotionDetector::getOrientation() { return orientation; }
+
+unsigned int MotionDetector::getMagnitude() { return magnitude; }
+
+unsigned long MotionDetector::getMotionEnergy() { return energySum; }
+
+unsigned int MotionDetector::getPeakMilliG() {
+  return (unsigned int) ((unsigned long) peak * 1000 / countsPerG);
+}
+
+bool MotionDetector::addFields(Message &msg) {
+  //  Add the events, orientation and shock peak to the message.  The peak is sent
+  //  in centi-g so that it fits into a field.  Returns false if the fields don't fit
+  //  into the message.  Call clearEvents() after sending, so the events are not lost if the send fails.
+  unsigned int peakCentiG = getPeakMilliG() / 10;
+  if (peakCentiG > 3276) peakCentiG = 3276;
+  if (!msg.addField(Message::nameCode("evt"), (int) events)) return false;
+  if (!msg.addField(Message::nameCode("ori"), (int) orientation)) return false;
+  return msg.addField(Message::nameCode("pk"), (int) peakCentiG);
+}
@@ -0,0 +1,73 @@
+//  Library for detecting motion, tilt and shock events from accelerometer samples,
+//  so that we send SIGFOX messages only when something happens.  Uses integer math only.
+#ifndef UNABIZ_ARDUINO_MOTIONDETECTOR_H
+#define UNABIZ_ARDUINO_MOTIONDETECTOR_H
+
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+const uint8_t MOTION_WINDOW = 8;  //  Number of samples in the circular window.  Must be a power of 2.
+const int COUNTS_PER_G = 4096;  //  MMA8451 raw counts per g in the 2G range.
+const int COUNTS_PER_G_8G = 1024;  //  MMA8451 raw counts per g in the 8G range.
+
+//  Events detected.  May be combined, e.g. MOTION_EVENT | SHOCK_EVENT.
+enum MotionEvent {
+  MOTION_EVENT = 1,  //  Started moving.
+  STILL_EVENT = 2,  //  Stopped moving.
+  TILT_EVENT = 4,  //  Orientation changed, e.g. tipped over.
+  SHOCK_EVENT = 8,  //  Sudden acceleration, e.g. dropped or hit.
+};
+
+//  Orientation of the device, by the axis that points down.
+enum Orientation {
+  ORIENTATION_UNKNOWN = 0,
+  ORIENTATION_X_UP = 1, ORIENTATION_X_DOWN = 2,
+  ORIENTATION_Y_UP = 3, ORIENTATION_Y_DOWN = 4,
+  ORIENTATION_Z_UP = 5, ORIENTATION_Z_DOWN = 6,
+};
+
+class MotionDetector
+{
+public:
+  MotionDetector(int countsPerG = COUNTS_PER_G);  //  countsPerG is the raw reading for 1 g.
+  uint8_t update(int x, int y, int z);  //  Add a raw sample.  Returns the MotionEvent flags detected by this sample.
+  uint8_t getEvents();  //  Return the MotionEvent flags detected since the last clearEvents().
+  void clearEvents();  //  Clear the events and the shock peak, e.g. after sending them.
+  bool addFields(Message &msg);  //  Add the events, orientation and shock peak to the message.
+  void setMotionThreshold(unsigned int milliG);  //  Moving if the motion averages above this.  Default 50 milli-g.
+  void setShockThreshold(unsigned int milliG);  //  Shock if the acceleration deviates from 1 g by this.  Default 1500 milli-g, which needs the 4G or 8G range.
+  bool isMoving();  //  Return true if moving now.
+  Orientation getOrientation();  //  Return the stable orientation.
+  unsigned int getMagnitude();  //  Return the magnitude of the last sample in raw counts.
+  unsigned long getMotionEnergy();  //  Return the motion energy over the window.
+  unsigned int getPeakMilliG();  //  Return the largest deviation from 1 g since the events were cleared.
+  static unsigned int isqrt(unsigned long n);  //  Integer square root.
+
+private:
+  Orientation orientationOf(long gx, long gy, long gz);  //  Return the orientation for the gravity vector.
+  unsigned long energyThreshold(unsigned int milliG);  //  Convert milli-g to the window energy threshold.
+
+  int countsPerG;  //  Raw reading for 1 g.
+  long gravity[3] = {0, 0, 0};  //  Low-pass filtered samples, scaled by 16.  Removed to get the motion.
+  uint16_t energy[MOTION_WINDOW];  //  Motion energy of each sample in the window.
+  unsigned long energySum = 0;  //  Sum of energy[].
+  unsigned long motionThreshold;  //  Moving if energySum exceeds this.
+  unsigned int shockThreshold;  //  Shock if the magnitude deviates from 1 g by this many counts.
+  unsigned int magnitude = 0;  //  Magnitude of the last sample.
+  unsigned int peak = 0;  //  Largest deviation from 1 g in counts since the events were cleared.
+  uint8_t index = 0;  //  Next position in the window.
+  uint8_t sampleCount = 0;  //  Number of samples until the window is filled, up to MOTION_WINDOW.
+  uint8_t events = 0;  //  MotionEvent flags since the events were cleared.
+  bool moving = false;  //  True if moving now.
+  bool shocked = false;  //  True while the shock threshold is exceeded, so we report each shock once.
+  Orientation orientation = ORIENTATION_UNKNOWN;  //  Stable orientation.
+  Orientation newOrientation = ORIENTATION_UNKNOWN;  //  Orientation waiting to become stable.
+  uint8_t stableCount = 0;  //  Number of samples that newOrientation has been seen.
+};
+
+#endif  //  UNABIZ_ARDUINO_MOTIONDETECTOR_H
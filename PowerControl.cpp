@@ -0,0 +1,81 @@
+//  Library for adapting the transmit power of the Wisol module to the link quality.  Nodes near
+//  a base station don't need full power, so we step the power down while the server reports
+//  few lost frames, and step it up quickly when frames are lost.  The server measures the loss
+//  from the sequence numbers with LossEstimator and sends it back in a link feedback downlink.
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+#include "SIGFOX.h"
+
+PowerControl::PowerControl(Wisol &transceiver) {
+  wisol = &transceiver;
+}
+
+bool PowerControl::begin() {
+  //  Start at the max power until the server reports the loss.  In RCZ2 and RCZ4 the module
+  //  transmits at its fixed power, so there is nothing to control and reportLoss() returns false.
+  goodReports = 0;
+  adjustable = false;
+  setRange(minPower, maxPower);  //  Limit the max to the zone.
+  if (wisol->getMaxPower() < 0) return false;
+  adjustable = true;
+  return apply(maxPower);
+}
+
+void PowerControl::setRange(int minPower0, int maxPower0) {
+  //  Limit the output power in dBm, e.g. keep a margin above the min for a node that moves.
+  //  The max is also limited to the max of the zone, because Wisol would lower it anyway.
+  const int zoneMax = wisol->getMaxPower();
+  const int limit = (zoneMax >= WISOL_MIN_POWER) ? zoneMax : WISOL_MAX_POWER;
+  minPower = (minPower0 < WISOL_MIN_POWER) ? WISOL_MIN_POWER : minPower0;
+  maxPower = (maxPower0 > limit) ? limit : maxPower0;
+  if (minPower > maxPower) minPower = maxPower;
+  if (!adjustable) return;
+  if (power > maxPower) apply(maxPower);
+  if (power < minPower) apply(minPower);
+}
+
+bool PowerControl::handleDownlink(const String &response) {
+  //  Adjust the power if the downlink is link feedback.  Returns true if handled.
+  //  Pass the response from DownlinkPolicy here, like SyncClock::handleDownlink().
+  if (response.length() < 4 || DownlinkPolicy::hexByte(response, 0) != LINK_FEEDBACK_COMMAND) return false;
+  const int lossPercent = DownlinkPolicy::hexByte(response, 2);
+  if (lossPercent < 0) return false;
+  reportLoss((uint8_t) lossPercent);
+  return true;
+}
+
+bool PowerControl::reportLoss(uint8_t lossPercent) {
+  //  High loss steps the power up at once, because lost frames are lost data.  Low loss
+  //  steps it down by 1 dB only after several good reports, so that a short spell of good
+  //  coverage doesn't take us too low.  Loss in between keeps the power.
+  if (!adjustable) return false;
+  if (lossPercent > HIGH_LOSS) {
+    goodReports = 0;
+    return apply(power + POWER_STEP_UP);
+  }
+  if (lossPercent >= LOW_LOSS) {
+    goodReports = 0;
+    return true;
+  }
+  if (++goodReports < GOOD_REPORTS) return true;
+  goodReports = 0;
+  return apply(power - POWER_STEP_DOWN);
+}
+
+int PowerControl::getPower() { return power; }
+
+bool PowerControl::apply(int power0) {
+  //  Set the output power of the module, within the range.  The power is kept
+  //  only if the module accepted it, so getPower() returns the power in use.
+  if (power0 < minPower) power0 = minPower;
+  if (power0 > maxPower) power0 = maxPower;
+  if (!wisol->setPower(power0)) return false;
+  power = power0;
+  return true;
+}
@@ -0,0 +1,46 @@
+//  Library for adapting the transmit power of the Wisol module to the link quality.  Nodes near
+//  a base station don't need full power, so we step the power down while the server reports
+//  few lost frames, and step it up quickly when frames are lost.  The server measures the loss
+//  from the sequence numbers with LossEstimator and sends it back in a link feedback downlink.
+#ifndef UNABIZ_ARDUINO_POWERCONTROL_H
+#define UNABIZ_ARDUINO_POWERCONTROL_H
+
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+//  Link feedback downlink: 8 bytes as 16 hex digits.  Byte 0 is the command,
+//  byte 1 is the percent of frames lost recently.  The rest are ignored.
+const uint8_t LINK_FEEDBACK_COMMAND = 0x02;
+const uint8_t LOW_LOSS = 2;  //  Loss below 2% is good enough to try lower power.
+const uint8_t HIGH_LOSS = 10;  //  Loss above 10% needs more power.
+const uint8_t GOOD_REPORTS = 3;  //  Step down only after 3 good reports in a row.
+const int POWER_STEP_DOWN = 1;  //  Step down slowly, 1 dB at a time.
+const int POWER_STEP_UP = 3;  //  Step up quickly, 3 dB at a time.
+
+class PowerControl
+{
+public:
+  PowerControl(Wisol &transceiver);  //  Control the output power of Wisol.
+  bool begin();  //  Start at the max power.  Returns false if the module fixes the power in the zone (RCZ2, RCZ4).
+  void setRange(int minPower, int maxPower);  //  Limit the output power in dBm.  Defaults to the range of the module and zone.
+  bool handleDownlink(const String &response);  //  Adjust the power if the downlink is link feedback.  Returns true if handled.
+  bool reportLoss(uint8_t lossPercent);  //  Adjust the power for the loss reported by the server.  Returns false if not set.
+  int getPower();  //  Return the output power in dBm.
+
+private:
+  bool apply(int power);  //  Set the output power of the module.
+
+  Wisol *wisol;
+  int minPower = WISOL_MIN_POWER;  //  Lowest power allowed.
+  int maxPower = WISOL_MAX_POWER;  //  Highest power allowed.
+  int power = WISOL_MAX_POWER;  //  Current output power, as set in the module.
+  bool adjustable = false;  //  True after begin() if the power may be set in the zone.
+  uint8_t goodReports = 0;  //  Number of reports in a row with low loss.
+};
+
+#endif  //  UNABIZ_ARDUINO_POWERCONTROL_H
@@ -23,15 +23,14 @@
 
 static NullPort nullPort;
 
-/* TODO: Run some sanity checks to ensure that Radiocrafts module is configured OK.
-  //  Get network mode for transmission.  Should return network mode = 0 for uplink only, no downlink.
-  Serial.println(F("\nGetting network mode (expecting 0)..."));
-  transceiver.getParameter(0x3b, result);
+//  Exit Command Mode has no response, so wait only briefly to confirm.
+static const int EXIT_TIMEOUT = 100;
 
-  //  Get baud rate.  Should return baud rate = 5 for 19200 bps.
-  Serial.println(F("\nGetting baud rate (expecting 5)..."));
-  transceiver.getParameter(0x30, result);
-*/
+//  Baud rate for each UART_BAUD code in the config memory.
+static const uint8_t baudRateCount = 12;
+static const unsigned long baudRates[baudRateCount] = {
+  1200, 2400, 4800, 9600, 14400, 19200, 28800, 38400, 57600, 76800, 115200, 230400,
+};
 
 Radiocrafts::Radiocrafts(Country country0, bool useEmulator0, const String device0, bool echo):
     Radiocrafts(country0, useEmulator0, device0, echo, RADIOCRAFTS_RX, RADIOCRAFTS_TX) {}  //  Forward to constructor below.
@@ -84,26 +83,58 @@ bool Radiocrafts::begin() {
     echoPort->print(F(" - SIGFOX ID = "));  Serial.println(id);
     echoPort->print(F(" - PAC = "));  Serial.println(pac);
 
-    //  Set the frequency of SIGFOX module.
+    //  Set the frequency of SIGFOX module for the zone of the country.  The module documents
+    //  frequency domains for RCZ1, RCZ2 and RCZ4 only, so countries in RCZ3 (Japan) stay on RCZ4.
     log2(F(" - Setting frequency for country "), (int) country);
-    if (country == COUNTRY_US) {  //  US runs on different frequency (RCZ2).
-      if (!setFrequencyUS(result)) continue;
-    } else if (country == COUNTRY_FR) {  //  France runs on different frequency (RCZ1).
-      if (!setFrequencyETSI(result)) continue;
-    } else { //  Rest of the world runs on RCZ4.
-      if (!setFrequencySG(result)) continue;
+    const int countryZone = (zoneOf(country) == 3) ? 4 : zoneOf(country);
+    if (!useEmulator && Storage::isZoneSaved(countryZone, id)) {
+      //  Zone was set and checked on an earlier boot.  Skip the config and memory read commands.
+      log1(F(" - Set frequency result = Saved"));
+      return true;  //  Init module succeeded.
     }
+    if (!setFrequency(countryZone, result)) continue;
     log2(F(" - Set frequency result = "), result);
 
     //  Get and display the frequency used by the SIGFOX module.  Should return 3 for RCZ4 (SG/TW).
     log1(F(" - Getting frequency (expecting 3)..."));  String frequency;
     if (!getFrequency(frequency)) continue;
     log2(F(" - Frequency (expecting 3) = "), frequency);
+    if (!useEmulator) Storage::saveZone(countryZone, id);
     return true;  //  Init module succeeded.
   }
   return false;  //  Failed to init module.
 }
 
+void Radiocrafts::drainLateResponse() {
+  //  Read the bytes that arrived since sendBuffer() started the port, so that the next command
+  //  doesn't count a stale '>' as its own.  Bytes sent while the port was ended are not seen.
+  String late;
+  while (serialPort->available() > 0) {
+    const int rxChar = serialPort->read();
+    if (rxChar == -1) break;
+    late.concat(toHex((char) rxChar));
+  }
+  classifyLateResponse(late);
+}
+
+void Radiocrafts::classifyLateResponse(const String &late) {
+  //  Count the bytes drained before a command, 2 hex digits per byte in either case.
+  //  Bytes ending with '>' are the late response to the last command, e.g. the prompt
+  //  after exitCommandMode() gave up.  Anything else is noise.
+  if (late.length() < 2) return;
+  if (late.substring(late.length() - 2).equalsIgnoreCase(toHex((char) END_OF_RESPONSE))) {
+    lateResponses++;
+    log4(F(" - Radiocrafts.sendBuffer: Late response to "), lastCommand, F(": "), late);
+  } else {
+    strayBytes += late.length() / 2;
+    log2(F(" - Radiocrafts.sendBuffer: Discarded stray bytes: "), late);
+  }
+}
+
+uint16_t Radiocrafts::getLateResponses() { return lateResponses; }
+
+uint16_t Radiocrafts::getStrayBytes() { return strayBytes; }
+
 bool Radiocrafts::sendMessage(const String &payload) {
   //  Payload contains a string of hex digits, up to 24 digits / 12 bytes.
   //  We convert to binary and send to SIGFOX.  Return true if successful.
@@ -125,6 +156,13 @@ bool Radiocrafts::sendMessage(const String &payload) {
   return false;
 }
 
+bool Radiocrafts::sendHeartbeat(bool bit) {
+  //  Send a 1-byte message to tell SIGFOX cloud that we are alive.  The module has no bit frames,
+  //  so this is the shortest frame it sends, about half the airtime and energy of a 12-byte message.
+  //  Counts as a message for the duty cycle.  Return true if successful.
+  return sendMessage(bit ? "01" : "00");
+}
+
 bool Radiocrafts::sendCommand(const String &cmd, uint8_t expectedMarkerCount,
                               String &result, uint8_t &actualMarkerCount) {
   //  Send a Radiocrafts command in Command Mode.
@@ -150,6 +188,8 @@ bool Radiocrafts::sendConfigCommand(const String &cmd, String &result) {
   //  cmd contains a string of hex digits, up to 24 digits / 12 bytes.
   //  We convert to binary and send to SIGFOX.  Return true if successful.
   String data;
+  //  The config may change, so read it again when needed.
+  for (uint8_t i = 0; i < CONFIG_IMAGE_SIZE / 8; i++) configValid[i] = 0;
   //  Enter config mode.
   if (!enterConfigMode()) return false;
   uint8_t actualMarkerCount = 0;
@@ -179,7 +219,8 @@ bool Radiocrafts::sendBuffer(const String &buffer, const int timeout,
   if (useEmulator) return true;
 
   actualMarkerCount = 0;
-  //  Start serial interface.
+  //  Start serial interface.  The port is ended between sessions, so the drain below only
+  //  sees bytes that arrive during the 200 ms after begin(), not those sent while it was closed.
   serialPort->begin(MODEM_BITS_PER_SECOND);
 #ifdef BEAN_BEAN_BEAN_H
   Bean.sleep(200);
@@ -188,6 +229,8 @@ bool Radiocrafts::sendBuffer(const String &buffer, const int timeout,
 #endif // BEAN_BEAN_BEAN_H
   serialPort->flush();
   serialPort->listen();
+  drainLateResponse();
+  lastCommand = buffer;
 
   //  Send the buffer: need to write/read char by char because of echo.
   const char *rawBuffer = buffer.c_str();
@@ -334,7 +377,7 @@ bool Radiocrafts::exitCommandMode() {
   for (;;) {
     //  Keep sending the exit command until we are really sure.  Sometimes we might out of sync.
     uint8_t markers = 0;
-    if (!sendBuffer(toHex('X'), COMMAND_TIMEOUT, 0, modeData, markers)) return false;
+    if (!sendBuffer(toHex('X'), EXIT_TIMEOUT, 0, modeData, markers)) return false;
     if (modeData == String("") && markers == 0) break;
     log1(F(" - Warning: Radiocrafts.exitCommandMode resending exit command, may be in incorrect mode"));
   }
@@ -424,6 +467,38 @@ bool Radiocrafts::getVoltage(float &voltage) {
   return true;
 }
 
+bool Radiocrafts::getTelemetry(float &temperature, float &voltage, unsigned long maxAge) {
+  //  Returns the temperature and power supply voltage of the SIGFOX module.  Both commands are
+  //  sent in one command mode session, instead of entering and exiting command mode for each.
+  //  If the last reading is newer than maxAge milliseconds, return it without talking to the module.
+  if (telemetryValid && millis() - telemetryTime < maxAge) {
+    temperature = telemetryTemperature;
+    voltage = telemetryVoltage;
+    return true;
+  }
+  uint8_t markers = 0;
+  //  Each command returns 1 byte followed by the '>' prompt.
+  if (!sendCommand(toHex('U') + toHex('V'), 2, data, markers)) return false;
+  if (data.length() == 4) {
+    telemetryTemperature = hexDigitToDecimal(data.charAt(0)) * 16 +
+                           hexDigitToDecimal(data.charAt(1)) - 128;
+    telemetryVoltage = 0.030 * (hexDigitToDecimal(data.charAt(2)) * 16 +
+                                hexDigitToDecimal(data.charAt(3)));
+  } else if (useEmulator) {
+    telemetryTemperature = 36;
+    telemetryVoltage = 12.3;
+  } else {
+    log2(F(" - Radiocrafts.getTelemetry: Unknown response: "), data);
+    return false;
+  }
+  telemetryTime = millis();
+  telemetryValid = true;
+  temperature = telemetryTemperature;
+  voltage = telemetryVoltage;
+  log4(F(" - Radiocrafts.getTelemetry: returned "), temperature, F(", "), voltage);
+  return true;
+}
+
 bool Radiocrafts::getHardware(String &hardware) {
   //  TODO
   log1(F(" - Radiocrafts.getHardware: ERROR - Not implemented"));
@@ -439,18 +514,155 @@ bool Radiocrafts::getFirmware(String &firmware) {
 }
 
 bool Radiocrafts::getParameter(uint8_t address, String &value) {
-  //  Read the parameter at the address.
-  log2(F(" - Radiocrafts.getParameter: address=0x"), toHex((char) address));
-  uint8_t markers = 0;
-  if (!sendCommand(toHex(CMD_READ_MEMORY) +   //  Read memory ('Y')
-                   toHex((char) address),  //  Address of parameter
-                   2,  //  Expect 1 marker for command, 1 for response.
-                   data, markers)) return false;
-  value = data;
+  //  Read the parameter at the address.  Uses the cached config image if read before.
+  uint8_t b = 0;
+  if (address < CONFIG_IMAGE_SIZE) {
+    if (!getConfig(address, b)) return false;
+  } else {
+    if (!enterCommandMode()) return false;
+    const bool ok = readAddresses(&address, 1);
+    exitCommandMode();
+    if (!ok) return false;
+    b = hexDigitToDecimal(data.charAt(0)) * 16 + hexDigitToDecimal(data.charAt(1));
+  }
+  value = toHex((char) b);
   log4(F(" - Radiocrafts.getParameter: address=0x"), toHex((char) address), F(" returned "), value);
   return true;
 }
 
+static bool configBit(const uint8_t bits[], uint8_t address) {
+  return (bits[address / 8] >> (address % 8)) & 1;
+}
+
+static void setConfigBit(uint8_t bits[], uint8_t address, bool value) {
+  if (value) bits[address / 8] |= (uint8_t) (1 << (address % 8));
+  else bits[address / 8] &= (uint8_t) ~(1 << (address % 8));
+}
+
+bool Radiocrafts::readAddresses(const uint8_t addresses[], uint8_t count) {
+  //  Read the config bytes at the addresses into the image.  Must be in Command Mode.
+  //  Each read ('Y' + address) returns '>' for the command, then the value and '>',
+  //  so we send up to CONFIG_READ_CHUNK reads in one buffer.  A value of '>' looks
+  //  like a marker, so if a chunk returns too few values we read it one at a time.
+  for (uint8_t start = 0; start < count; start += CONFIG_READ_CHUNK) {
+    const uint8_t n = (count - start < CONFIG_READ_CHUNK) ? count - start : CONFIG_READ_CHUNK;
+    String cmd;
+    for (uint8_t i = 0; i < n; i++) cmd.concat(toHex(CMD_READ_MEMORY) + toHex((char) addresses[start + i]));
+    uint8_t markers = 0;
+    if (!sendBuffer(cmd, COMMAND_TIMEOUT, 2 * n, data, markers)) return false;
+    if (useEmulator) data = "";
+    for (uint8_t i = 0; i < n; i++) {
+      const uint8_t address = addresses[start + i];
+      String value = data.substring(i * 2, i * 2 + 2);
+      if (data.length() != n * 2) {
+        if (useEmulator) value = "00";  //  Emulator has no config memory.
+        else {
+          if (!sendBuffer(toHex(CMD_READ_MEMORY) + toHex((char) address), COMMAND_TIMEOUT,
+                          2, value, markers)) return false;
+          if (value.length() == 0) value = toHex(END_OF_RESPONSE);
+        }
+      }
+      if (address < CONFIG_IMAGE_SIZE) {
+        configImage[address] = hexDigitToDecimal(value.charAt(0)) * 16 + hexDigitToDecimal(value.charAt(1));
+        setConfigBit(configValid, address, true);
+        setConfigBit(configDirty, address, false);
+      }
+      if (n == 1) data = value;
+    }
+  }
+  return true;
+}
+
+bool Radiocrafts::readConfig(uint8_t first, uint8_t count) {
+  //  Read count bytes of config memory from the address first into the cached image,
+  //  entering and exiting Command Mode once for all of them.
+  if (first >= CONFIG_IMAGE_SIZE) return false;
+  if (count > CONFIG_IMAGE_SIZE - first) count = CONFIG_IMAGE_SIZE - first;
+  log4(F(" - Radiocrafts.readConfig: address=0x"), toHex((char) first), F(" count="), count);
+  uint8_t addresses[CONFIG_READ_CHUNK];
+  if (!enterCommandMode()) return false;
+  bool ok = true;
+  for (uint8_t start = 0; ok && start < count; start += CONFIG_READ_CHUNK) {
+    const uint8_t n = (count - start < CONFIG_READ_CHUNK) ? count - start : CONFIG_READ_CHUNK;
+    for (uint8_t i = 0; i < n; i++) addresses[i] = first + start + i;
+    ok = readAddresses(addresses, n);
+  }
+  exitCommandMode();
+  return ok;
+}
+
+bool Radiocrafts::getConfig(uint8_t address, uint8_t &value) {
+  //  Return the config byte from the image.  If not cached, read it from the module.
+  //  Call readConfig() first to read all the bytes needed in one session.
+  if (address >= CONFIG_IMAGE_SIZE) return false;
+  if (!configBit(configValid, address) && !readConfig(address, 1)) return false;
+  value = configImage[address];
+  return true;
+}
+
+bool Radiocrafts::setConfig(uint8_t address, uint8_t value) {
+  //  Change the config byte in the image.  If it's the same as the cached value, there is
+  //  nothing to write.  Call writeConfig() to write all the changes in one session.
+  if (address >= CONFIG_IMAGE_SIZE) return false;
+  if (configBit(configValid, address) && configImage[address] == value) return true;
+  configImage[address] = value;
+  setConfigBit(configDirty, address, true);
+  return true;
+}
+
+bool Radiocrafts::writeConfig() {
+  //  Write the changed config bytes as address and value pairs in one config session.
+  //  The written bytes stay cached, the rest are read again when needed.
+  String cmd;
+  for (uint8_t address = 0; address < CONFIG_IMAGE_SIZE; address++)
+    if (configBit(configDirty, address)) cmd.concat(toHex((char) address) + toHex((char) configImage[address]));
+  if (cmd.length() == 0) return true;  //  Nothing changed.
+  log2(F(" - Radiocrafts.writeConfig: "), cmd);
+  if (!sendConfigCommand(cmd, data)) return false;
+  for (uint8_t address = 0; address < CONFIG_IMAGE_SIZE; address++) {
+    if (!configBit(configDirty, address)) continue;
+    setConfigBit(configDirty, address, false);
+    setConfigBit(configValid, address, true);
+  }
+  return true;
+}
+
+bool Radiocrafts::getRCZ(uint8_t &zone) {
+  //  Return the zone 1 to 4 from the frequency domain.
+  uint8_t domain = 0;
+  if (!getConfig(CONFIG_FREQUENCY_DOMAIN, domain)) return false;
+  zone = domain + 1;
+  return true;
+}
+
+bool Radiocrafts::getNetworkMode(uint8_t &networkMode) {
+  //  Return the network mode, 0 for uplink only, no downlink.
+  return getConfig(CONFIG_NETWORK_MODE, networkMode);
+}
+
+bool Radiocrafts::getBaudRate(unsigned long &bps) {
+  //  Return the baud rate of the module in bits per second, or 0 if the code is unknown.
+  uint8_t code = 0;
+  if (!getConfig(CONFIG_BAUD_RATE, code)) return false;
+  bps = (code < baudRateCount) ? baudRates[code] : 0;
+  return true;
+}
+
+bool Radiocrafts::auditConfig() {
+  //  Check that the module is configured for our zone, uplink only and 19200 bps.
+  //  All the bytes are read in one Command Mode session.  Returns true if OK.
+  static const uint8_t auditAddresses[] = { CONFIG_FREQUENCY_DOMAIN, CONFIG_BAUD_RATE, CONFIG_NETWORK_MODE };
+  if (!enterCommandMode()) return false;
+  const bool ok = readAddresses(auditAddresses, sizeof(auditAddresses));
+  exitCommandMode();
+  if (!ok) return false;
+  uint8_t zone = 0, networkMode = 0;  unsigned long bps = 0;
+  getRCZ(zone);  getNetworkMode(networkMode);  getBaudRate(bps);
+  log4(F(" - Radiocrafts.auditConfig: zone="), zone, F(" networkMode="), networkMode);
+  log2(F(" - Radiocrafts.auditConfig: bps="), String(bps));
+  return networkMode == 0 && bps == MODEM_BITS_PER_SECOND;
+}
+
 bool Radiocrafts::getPower(int &power) {
   //  Get the power step-down.
   if (!getParameter(0x01, data)) return false;  //  Address of parameter = RF_POWER (0x01)
@@ -508,15 +720,19 @@ bool Radiocrafts::getFrequency(String &result) {
 }
 
 bool Radiocrafts::setFrequency(int zone, String &result) {
-  //  Get the frequency used for the SIGFOX module
+  //  Set the frequency used for the SIGFOX module
   //  0: Europe (RCZ1)
   //  1: US (RCZ2)
   //  3: AU/NZ (RCZ4)
-  if (!sendConfigCommand(String() +
-    "00" + //  Address of parameter = RF_FREQUENCY_DOMAIN (0x0)
-    toHex((char) (zone - 1)),  //  Value of parameter = RCZ - 1
-    data)) return false;
-  result = data;
+  //  Written only if different, because each config write goes to the
+  //  non-volatile memory of the module.  Domain 2 (RCZ3) is not documented, so it is rejected.
+  if (zone != 1 && zone != 2 && zone != 4) {
+    log2(F(" - Radiocrafts.setFrequency: Unsupported zone "), zone);
+    return false;
+  }
+  if (!setConfig(CONFIG_FREQUENCY_DOMAIN, (uint8_t) (zone - 1))) return false;
+  if (!writeConfig()) return false;
+  result = toHex((char) (zone - 1));
   return true;
 }
 
@@ -541,8 +757,9 @@ bool Radiocrafts::setFrequencyUS(String &result) {
   return setFrequency(2, result); }
 
 bool Radiocrafts::writeSettings(String &result) {
-  //  TODO: Write settings to module's flash memory.
-  log1(F(" - Radiocrafts.writeSettings: ERROR - Not implemented"));
+  //  Settings written in Config Mode are already saved in the non-volatile memory of the module.
+  log1(F(" - Radiocrafts.writeSettings: Saved by Config Mode"));
+  result = "OK";
   return true;
 }
 
@@ -32,6 +32,15 @@ enum Mode {
   CONFIG_MODE = 2,
 };
 
+//  Config memory of the module, cached by readConfig().
+const uint8_t CONFIG_IMAGE_SIZE = 0x40;  //  Cache addresses 0x00 to 0x3f, which include all the parameters we use.
+const uint8_t CONFIG_READ_CHUNK = 8;  //  Read up to 8 addresses per buffer sent.
+const uint8_t CONFIG_FREQUENCY_DOMAIN = 0x00;  //  RCZ - 1.
+const uint8_t CONFIG_RF_POWER = 0x01;  //  Output power.
+const uint8_t CONFIG_PUBLIC_KEY = 0x28;  //  1 if the public key of the emulator is used.
+const uint8_t CONFIG_BAUD_RATE = 0x30;  //  5 for 19200 bps.
+const uint8_t CONFIG_NETWORK_MODE = 0x3b;  //  0 for uplink only.
+
 class Radiocrafts
 {
 public:
@@ -46,6 +55,7 @@ public:
   bool isReady();
   bool sendMessage(const String &payload);  //  Send the payload of hex digits to the network, max 12 bytes.
   bool sendString(const String &str);  //  Sending a text string, max 12 characters allowed.
+  bool sendHeartbeat(bool bit = true);  //  Send a 1-byte message, the shortest frame, to show that we are alive.
   bool receive(String &data);  //  Receive a message.
   bool enterCommandMode();  //  Enter Command Mode for sending module commands, not data.
   bool exitCommandMode();  //  Exit Command Mode and return to Send Mode so we can send data.
@@ -69,11 +79,23 @@ public:
   bool getTemperature(int &temperature);
   bool getID(String &id, String &pac);  //  Get the SIGFOX ID and PAC for the module.
   bool getVoltage(float &voltage);
+  bool getTelemetry(float &temperature, float &voltage, unsigned long maxAge = TELEMETRY_MAX_AGE);  //  Read temperature and voltage together, or reuse the last reading.
   bool getHardware(String &hardware);
   bool getFirmware(String &firmware);
   bool getPower(int &power);
   bool setPower(int power);
   bool getParameter(uint8_t address, String &value);  //  Return the parameter at that address.
+  uint16_t getLateResponses();  //  Return the number of responses that arrived after their command timed out.
+  uint16_t getStrayBytes();  //  Return the number of bytes received that were not a response to any command.
+  void classifyLateResponse(const String &late);  //  Count the bytes drained before a command, in hex, as a late response or stray bytes.
+  bool readConfig(uint8_t first = 0, uint8_t count = CONFIG_IMAGE_SIZE);  //  Read the config memory into the cached image in one session.
+  bool getConfig(uint8_t address, uint8_t &value);  //  Return the config byte from the image, reading it if not cached.
+  bool setConfig(uint8_t address, uint8_t value);  //  Change the config byte in the image if different.  Written by writeConfig().
+  bool writeConfig();  //  Write the changed config bytes in one config session.
+  bool getRCZ(uint8_t &zone);  //  Return the zone 1 to 4 from the frequency domain.
+  bool getNetworkMode(uint8_t &networkMode);  //  Return the network mode, 0 for uplink only.
+  bool getBaudRate(unsigned long &bps);  //  Return the baud rate of the module.
+  bool auditConfig();  //  Check the zone, network mode and baud rate in one session.  Returns true if OK.
 
   //  Message conversion functions.
   String toHex(int i);
@@ -95,6 +117,8 @@ private:
   bool enterConfigMode();  //  Enter Config Mode for setting config.
   bool exitConfigMode();  //  Exit Config Mode and return to Send Mode so we can send data.
   uint8_t hexDigitToDecimal(char ch);
+  void drainLateResponse();  //  Read and classify the bytes received since the port was started, before sending.
+  bool readAddresses(const uint8_t addresses[], uint8_t count);  //  Read the config bytes into the image.  Must be in Command Mode.
   void logBuffer(const __FlashStringHelper *prefix, const char *buffer,
                  uint8_t markerPos[], uint8_t markerCount);
 
@@ -106,6 +130,16 @@ private:
   Print *echoPort;  //  Port for sending echo output.  Defaults to Serial.
   Print *lastEchoPort;  //  Last port used for sending echo output.
   unsigned long lastSend;  //  Timestamp of last send.
+  uint8_t configImage[CONFIG_IMAGE_SIZE];  //  Cached config memory.
+  uint8_t configValid[CONFIG_IMAGE_SIZE / 8] = {0};  //  Bit set if the config byte has been read.
+  uint8_t configDirty[CONFIG_IMAGE_SIZE / 8] = {0};  //  Bit set if the config byte has been changed but not written.
+  String lastCommand;  //  Last command sent in hex, for attributing a late response.
+  uint16_t lateResponses = 0;  //  Number of responses received after their command timed out.
+  uint16_t strayBytes = 0;  //  Number of bytes received that were not a response.
+  unsigned long telemetryTime = 0;  //  Timestamp of the last telemetry reading.
+  bool telemetryValid = false;  //  True after the first telemetry reading.
+  float telemetryTemperature = 0;  //  Module temperature at the last telemetry reading.
+  float telemetryVoltage = 0;  //  Module voltage at the last telemetry reading.
 };
 
 #endif // UNABIZ_ARDUINO_RADIOCRAFTS_H
@@ -7,6 +7,7 @@
 const unsigned long SEND_DELAY = (unsigned long) 10 * 60 * 1000;
 const unsigned int MAX_BYTES_PER_MESSAGE = 12;  //  Only 12 bytes per message.
 const unsigned int COMMAND_TIMEOUT = 1000;  //  Wait up to 1 second for response from SIGFOX module.
+const unsigned long TELEMETRY_MAX_AGE = SEND_DELAY;  //  Reuse the module temperature and voltage read within 10 minutes.
 
 //  Define the countries that are supported.
 enum Country {
@@ -22,6 +23,9 @@ enum Country {
   COUNTRY_TW = 'T'+('W' << 8),  //  Taiwan: RCZ4
 };
 
+//  SIGFOX zones and the zone used in each country.
+#include "Zone.h"
+
 #ifdef BEAN_BEAN_BEAN_H
   //  Bean+ firmware 0.6.1 can't receive serial data properly. We provide
   //  an alternative class BeanSoftwareSerial to work around this.
@@ -38,13 +42,49 @@ enum Country {
 //  Send structured messages to SIGFOX cloud.
 #include "Message.h"
 
+//  Sample sensors at different rates and send the aggregated samples.
+#include "Scheduler.h"
+
+//  Detect motion, tilt and shock events from accelerometer samples.
+#include "MotionDetector.h"
+
+//  Wake up and send when a button or alarm pin is triggered.
+#include "WakeupPin.h"
+
+//  Read DHT temperature and humidity sensors without blocking.
+#include "DHTReader.h"
+
+//  Detect abnormal sensor values and send alerts.
+#include "AnomalyDetector.h"
+
+//  Stretch the send interval as the battery drains.
+#include "BatteryPolicy.h"
+
+//  Request downlinks only when needed.
+#include "DownlinkPolicy.h"
+
+//  Keep the real time, synchronized by a downlink.
+#include "SyncClock.h"
+
+//  Store data in EEPROM that must survive resets.
+#include "Storage.h"
+
+//  Log samples in EEPROM while we can't send, and backfill them later.
+#include "SampleLog.h"
+
+//  Estimate the frames lost from the sequence numbers received, on the server side.
+#include "LossEstimator.h"
+
+//  Adapt the Wisol transmit power to the loss reported by the server.
+#include "PowerControl.h"
+
 //  Define aliases for each UnaShield and the transceiver it uses.
 #define UnaShieldV1 Radiocrafts
 #define UnaShieldV2S Wisol
 
 //  Drop all data passed to this port.  Used to suppress echo output.
 class NullPort: public Print {
-  virtual size_t write(uint8_t) {}
+  virtual size_t write(uint8_t) { return 1; }
 };
 
 //  Call this function if we need to stop.  This informs the emulator to stop listening.
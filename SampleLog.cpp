@@ -0,0 +1,301 @@
+//  Library for logging sensor samples in EEPROM while we can't send, e.g. out of coverage,
+//  and sending a summary of the missed samples when we can send again.  Samples are stored as
+//  bit-packed differences from the previous sample, so 1 KB of EEPROM holds days of samples.
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+#include "SIGFOX.h"
+
+static const uint16_t EMPTY_BLOCK = 0xffff;  //  Erased EEPROM reads as 0xff.
+static const uint8_t MAX_BLOCK_SAMPLES = 0xff;  //  Sample count must fit in 1 byte.
+
+static uint16_t nextBlockNumber(uint16_t number) {
+  //  Return the number of the block after this one, skipping EMPTY_BLOCK.
+  return (number + 1 == EMPTY_BLOCK) ? 0 : number + 1;
+}
+
+static uint16_t readBits(unsigned int address, unsigned int &bitPos, uint8_t bits) {
+  //  Read bits from EEPROM, most significant first, starting at bitPos from the address.
+  uint16_t value = 0;
+  for (uint8_t i = 0; i < bits; i++, bitPos++) {
+    const uint8_t b = Storage::read(address + bitPos / 8);
+    value = (value << 1) | ((b >> (7 - bitPos % 8)) & 1);
+  }
+  return value;
+}
+
+SampleLog::SampleLog() {
+  for (uint8_t i = 0; i < MAX_LOG_FIELDS; i++) { names[i] = 0; last[i] = 0; }
+}
+
+bool SampleLog::begin(uint8_t fieldCount0) {
+  //  Find the newest block in EEPROM, so that we continue logging after a reset.
+  //  The newest block is followed by an empty block, or a block that doesn't continue the numbering.
+  if (fieldCount0 == 0 || fieldCount0 > MAX_LOG_FIELDS) return false;
+  fieldCount = fieldCount0;
+  started = false;
+  for (uint8_t block = 0; block < LOG_BLOCKS; block++) {
+    if (isEmpty(block)) continue;
+    const uint16_t number = Storage::readWord(blockAddress(block));
+    const uint8_t following = (block + 1) % LOG_BLOCKS;
+    if (!isEmpty(following) && Storage::readWord(blockAddress(following)) == nextBlockNumber(number)) continue;
+    current = block;
+    currentNumber = number;
+    count = decode(block, 0, 0, last, &bitPos);
+    nextSample = Storage::readWord(blockAddress(block) + 2) + count;
+    started = true;
+    break;
+  }
+  if (!started) {
+    nextSample = 0;
+    setSentSample(0);
+    return true;
+  }
+  //  Don't backfill more samples than we have.
+  sentSample = Storage::readWord(EEPROM_LOG);
+  if (findPendingBlock() < 0) sentSample = nextSample;
+  return true;
+}
+
+void SampleLog::setNames(unsigned int name0, unsigned int name1, unsigned int name2) {
+  //  Field names for the backfill messages, encoded by Message::nameCode().
+  names[0] = name0;  names[1] = name1;  names[2] = name2;
+}
+
+unsigned int SampleLog::blockAddress(uint8_t block) {
+  return EEPROM_LOG + LOG_HEADER_SIZE + (unsigned int) block * LOG_BLOCK_SIZE;
+}
+
+bool SampleLog::isEmpty(uint8_t block) {
+  return Storage::readWord(blockAddress(block)) == EMPTY_BLOCK;
+}
+
+uint8_t SampleLog::headerSize() {
+  return 5 + 2 * fieldCount;
+}
+
+void SampleLog::setSentSample(uint16_t sample) {
+  //  Samples before this have been sent.  Saved in EEPROM so that we continue the backfill
+  //  after a reset.  Written only after an outage, so the EEPROM doesn't wear out.
+  sentSample = sample;
+  Storage::writeWord(EEPROM_LOG, sample);
+}
+
+uint8_t SampleLog::encodedBits(int diff) {
+  //  Return the number of bits needed to encode the difference from the previous sample.
+  const long d = diff;
+  const unsigned long zigzag = (d < 0) ? (unsigned long) (-d) * 2 - 1 : (unsigned long) d * 2;
+  if (zigzag < 8) return 4;
+  if (zigzag < 64) return 8;
+  return 18;
+}
+
+void SampleLog::writeBits(uint16_t value, uint8_t bits) {
+  //  Write bits to the current block at bitPos, most significant first.  A byte that already
+  //  holds bits is read, merged and written again, so a byte may be written a few times.  It's
+  //  not buffered in RAM, because the sample count in the header is updated with every sample
+  //  and the log must stay readable after a reset.  Storage::write() skips unchanged bytes.
+  const unsigned int address = blockAddress(current);
+  while (bits > 0) {
+    const uint8_t offset = bitPos % 8;
+    const uint8_t n = (bits < 8 - offset) ? bits : 8 - offset;  //  Bits that fit into this byte.
+    const uint8_t shift = 8 - offset - n;
+    const uint8_t mask = ((1 << n) - 1) << shift;
+    const uint8_t chunk = (value >> (bits - n)) & ((1 << n) - 1);
+    const uint8_t b = Storage::read(address + bitPos / 8);
+    Storage::write(address + bitPos / 8, (b & ~mask) | (chunk << shift));
+    bits -= n;
+    bitPos += n;
+  }
+}
+
+void SampleLog::startBlock(uint8_t block, const int values[]) {
+  //  Start the block with the first sample.  If the block had samples that were not
+  //  backfilled yet, they are lost.
+  if (!isEmpty(block)) {
+    const unsigned int address = blockAddress(block);
+    const uint16_t end = Storage::readWord(address + 2) + Storage::read(address + 4);
+    if ((int16_t) (end - sentSample) > 0) setSentSample(end);
+  }
+  currentNumber = started ? nextBlockNumber(currentNumber) : 0;
+  current = block;
+  const unsigned int address = blockAddress(block);
+  Storage::writeWord(address, currentNumber);
+  Storage::writeWord(address + 2, nextSample);
+  Storage::write(address + 4, 1);
+  for (uint8_t i = 0; i < fieldCount; i++) {
+    Storage::writeWord(address + 5 + 2 * i, (uint16_t) values[i]);
+    last[i] = values[i];
+  }
+  count = 1;
+  bitPos = headerSize() * 8;
+  started = true;
+}
+
+bool SampleLog::append(const float values0[]) {
+  //  Log a sample that couldn't be sent, with a value for each field.  Each value is stored
+  //  in tenths as the difference from the previous sample, usually in 4 bits.
+  //  When the log is full, the oldest block is overwritten.
+  if (fieldCount == 0) return false;
+  int values[MAX_LOG_FIELDS];
+  unsigned int bits = 0;
+  for (uint8_t i = 0; i < fieldCount; i++) {
+    values[i] = Message::toTenths(values0[i]);
+    bits += encodedBits(values[i] - last[i]);
+  }
+  if (!started) startBlock(current, values);
+  else if (count >= MAX_BLOCK_SAMPLES || bitPos + bits > (unsigned int) LOG_BLOCK_SIZE * 8)
+    startBlock((current + 1) % LOG_BLOCKS, values);
+  else {
+    for (uint8_t i = 0; i < fieldCount; i++) {
+      const long d = (long) values[i] - last[i];
+      const uint16_t zigzag = (d < 0) ? (uint16_t) (-d * 2 - 1) : (uint16_t) (d * 2);
+      const uint8_t size = encodedBits(values[i] - last[i]);
+      if (size == 4) writeBits(zigzag, 4);
+      else if (size == 8) writeBits(0x80 | zigzag, 8);
+      else { writeBits(3, 2); writeBits((uint16_t) values[i], 16); }
+      last[i] = values[i];
+    }
+    count++;
+    Storage::write(blockAddress(current) + 4, count);
+  }
+  nextSample++;
+  return true;
+}
+
+uint8_t SampleLog::decode(uint8_t block, int values[][MAX_LOG_FIELDS], uint8_t maxSamples, int lastValues[],
+                          unsigned int *endBit, long sums[], uint8_t from) {
+  //  Decode the samples in the block into values, up to maxSamples.  Returns the number of samples
+  //  in the block.  Also returns the last sample, the end of the bits, and the sum of each field
+  //  from sample number from in the block, so we don't need memory for all the samples.
+  //  Pointers may be 0.
+  const unsigned int address = blockAddress(block);
+  const uint8_t samples = Storage::read(address + 4);
+  int sample[MAX_LOG_FIELDS];
+  for (uint8_t i = 0; i < fieldCount; i++) sample[i] = (int16_t) Storage::readWord(address + 5 + 2 * i);
+  unsigned int bit = headerSize() * 8;
+  for (uint8_t s = 0; s < samples; s++) {
+    if (s > 0) {
+      for (uint8_t i = 0; i < fieldCount; i++) {
+        if (readBits(address, bit, 1) == 0) {
+          const uint16_t zigzag = readBits(address, bit, 3);
+          sample[i] += (zigzag & 1) ? -(int) ((zigzag + 1) / 2) : (int) (zigzag / 2);
+        } else if (readBits(address, bit, 1) == 0) {
+          const uint16_t zigzag = readBits(address, bit, 6);
+          sample[i] += (zigzag & 1) ? -(int) ((zigzag + 1) / 2) : (int) (zigzag / 2);
+        } else sample[i] = (int16_t) readBits(address, bit, 16);
+      }
+    }
+    if (values && s < maxSamples)
+      for (uint8_t i = 0; i < fieldCount; i++) values[s][i] = sample[i];
+    if (sums && s >= from)
+      for (uint8_t i = 0; i < fieldCount; i++) sums[i] += sample[i];
+  }
+  if (lastValues) for (uint8_t i = 0; i < fieldCount; i++) lastValues[i] = sample[i];
+  if (endBit) *endBit = bit;
+  return samples;
+}
+
+uint8_t SampleLog::readBlock(uint8_t block, int values[][MAX_LOG_FIELDS], uint8_t maxSamples,
+                             uint16_t *firstSample) {
+  //  Decode the samples in the block, in tenths.  Returns the number of samples decoded,
+  //  and the sample number of the first sample.
+  if (block >= LOG_BLOCKS || isEmpty(block)) return 0;
+  if (firstSample) *firstSample = Storage::readWord(blockAddress(block) + 2);
+  const uint8_t samples = decode(block, values, maxSamples, 0, 0);
+  return (samples < maxSamples) ? samples : maxSamples;
+}
+
+int SampleLog::findPendingBlock() {
+  //  Return the oldest block with samples not backfilled, or -1 if none.
+  if (!started) return -1;
+  for (uint8_t i = 1; i <= LOG_BLOCKS; i++) {
+    const uint8_t block = (current + i) % LOG_BLOCKS;  //  From the oldest block to the current block.
+    if (isEmpty(block)) continue;
+    const unsigned int address = blockAddress(block);
+    const uint16_t first = Storage::readWord(address + 2);
+    const uint16_t end = first + Storage::read(address + 4);
+    if ((int16_t) (end - sentSample) > 0) {
+      //  Samples older than the block were overwritten.
+      if ((int16_t) (first - sentSample) > 0) sentSample = first;
+      return block;
+    }
+  }
+  return -1;
+}
+
+void SampleLog::discardPending() {
+  //  Don't backfill the samples logged so far.
+  setSentSample(nextSample);
+  backfillField = 0;
+}
+
+uint16_t SampleLog::getPendingCount() {
+  //  Return the number of samples logged but not backfilled.
+  if (findPendingBlock() < 0) return 0;
+  return nextSample - sentSample;
+}
+
+uint16_t SampleLog::getSampleNumber() {
+  return nextSample;
+}
+
+bool SampleLog::addBackfill(Message &msg) {
+  //  Add a summary of the oldest pending block to the message: how many samples ago
+  //  the middle sample was logged ("ago"), and the average of up to 2 fields.
+  //  Fields that don't fit, e.g. the third field or the second when the message has a sequence
+  //  number, are sent in the next backfill message.
+  //  Returns false if there is nothing to backfill or the fields don't fit.
+  const int block = findPendingBlock();
+  if (block < 0) return false;
+  const uint16_t first = Storage::readWord(blockAddress((uint8_t) block) + 2);
+  const uint8_t start = (uint8_t) (sentSample - first);
+  long sums[MAX_LOG_FIELDS] = {0, 0, 0};
+  const uint8_t samples = decode((uint8_t) block, 0, 0, 0, 0, sums, start);
+  if (start >= samples) return false;
+  long ago = (long) (uint16_t) (nextSample - (first + (start + samples) / 2));
+  if (ago > 3276) ago = 3276;
+  if (!msg.addField(Message::nameCode("ago"), (int) ago)) return false;
+  backfillCount = 0;
+  for (uint8_t i = backfillField; i < fieldCount && i < backfillField + 2 && msg.getCapacity() >= 4; i++) {
+    if (!msg.addField(names[i], (float) sums[i] / (samples - start) / 10.0f)) return false;
+    backfillCount++;
+  }
+  if (backfillCount == 0 && fieldCount > 0) return false;
+  backfillEnd = first + samples;
+  return true;
+}
+
+void SampleLog::backfillSent() {
+  //  The message from addBackfill() was sent.  Move on to the remaining fields, or the next block.
+  if (fieldCount > backfillField + backfillCount) { backfillField += backfillCount; return; }
+  backfillField = 0;
+  setSentSample(backfillEnd);
+}
+
+bool SampleLog::sendBackfill(Message &msg, Scheduler *scheduler) {
+  //  Send the next backfill message.  If there is a scheduler, send only if it has
+  //  send credits, so the backfill and the periodic sends comply with the duty cycle.
+  if (getPendingCount() == 0) return false;
+  if (scheduler && !scheduler->takeSendCredit()) return false;
+  msg.reset();
+  if (!addBackfill(msg) || !msg.send()) return false;
+  backfillSent();
+  return true;
+}
+
+void SampleLog::clear() {
+  //  Erase the log.
+  for (uint8_t block = 0; block < LOG_BLOCKS; block++) Storage::writeWord(blockAddress(block), EMPTY_BLOCK);
+  started = false;
+  current = 0;
+  count = 0;
+  nextSample = 0;
+  backfillField = 0;
+  setSentSample(0);
+}
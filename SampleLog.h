@@ -0,0 +1,71 @@
+//  Library for logging sensor samples in EEPROM while we can't send, e.g. out of coverage,
+//  and sending a summary of the missed samples when we can send again.  Samples are stored as
+//  bit-packed differences from the previous sample, so 1 KB of EEPROM holds days of samples.
+#ifndef UNABIZ_ARDUINO_SAMPLELOG_H
+#define UNABIZ_ARDUINO_SAMPLELOG_H
+
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+const uint8_t MAX_LOG_FIELDS = 3;  //  Max number of fields in each sample.
+const uint8_t LOG_BLOCK_SIZE = 32;  //  Samples are stored in blocks of 32 bytes, oldest block overwritten first.
+const uint8_t LOG_HEADER_SIZE = 2;  //  Log starts with the number of the oldest sample not sent yet.
+const uint8_t LOG_BLOCKS = (EEPROM_LOG_SIZE - LOG_HEADER_SIZE) / LOG_BLOCK_SIZE;  //  Number of blocks in the log.
+
+//  Each block contains a header, followed by the bit-packed samples:
+//  Bytes 0-1: Block number, to find the newest block after reset.  0xffff if empty.
+//  Bytes 2-3: Sample number of the first sample in the block.
+//  Byte 4: Number of samples in the block.
+//  Bytes 5 onwards: First sample of each field, 2 bytes each in tenths.
+//  Then for each following sample and each field, the zigzag-encoded difference from the
+//  previous sample: 0xxx (3 bits), 10xxxxxx (6 bits), or 11 followed by the 16-bit value.
+class SampleLog
+{
+public:
+  SampleLog();
+  bool begin(uint8_t fieldCount);  //  Find the newest block in EEPROM.  Returns false if too many fields.
+  void setNames(unsigned int name0, unsigned int name1 = 0, unsigned int name2 = 0);  //  Field names for the backfill, encoded by Message::nameCode().
+  bool append(const float values[]);  //  Log a sample that couldn't be sent, with a value for each field.
+  void discardPending();  //  Don't backfill the samples logged so far.
+  uint16_t getPendingCount();  //  Return the number of samples logged but not backfilled.
+  bool addBackfill(Message &msg);  //  Add a summary of the oldest pending block to the message.  Returns false if none.
+  void backfillSent();  //  The message from addBackfill() was sent.  Move on to the next summary.
+  bool sendBackfill(Message &msg, Scheduler *scheduler = 0);  //  Send the next summary if the scheduler has send credits.
+  uint16_t getSampleNumber();  //  Return the number of the next sample.
+  uint8_t readBlock(uint8_t block, int values[][MAX_LOG_FIELDS], uint8_t maxSamples,
+                    uint16_t *firstSample = 0);  //  Decode the samples in the block, in tenths.
+  void clear();  //  Erase the log.
+
+private:
+  unsigned int blockAddress(uint8_t block);  //  Return the EEPROM address of the block.
+  bool isEmpty(uint8_t block);  //  Return true if the block has never been written.
+  uint8_t decode(uint8_t block, int values[][MAX_LOG_FIELDS], uint8_t maxSamples, int lastValues[],
+                 unsigned int *endBit, long sums[] = 0, uint8_t from = 0);  //  Decode the block.  Pointers may be 0.
+  int findPendingBlock();  //  Return the oldest block with samples not backfilled, or -1 if none.
+  void setSentSample(uint16_t sample);  //  Samples before this have been sent.  Saved in EEPROM.
+  void startBlock(uint8_t block, const int values[]);  //  Start the block with the first sample.
+  void writeBits(uint16_t value, uint8_t bits);  //  Write bits to the current block at bitPos.
+  uint8_t encodedBits(int diff);  //  Return the number of bits needed to encode the difference.
+  uint8_t headerSize();  //  Return the size of the block header in bytes.
+
+  uint8_t fieldCount = 0;  //  Number of fields in each sample.
+  unsigned int names[MAX_LOG_FIELDS];  //  Names of the fields, encoded by Message::nameCode().
+  uint8_t current = 0;  //  Block being written.
+  uint16_t currentNumber = 0;  //  Block number of the current block.
+  uint8_t count = 0;  //  Number of samples in the current block.
+  unsigned int bitPos = 0;  //  Next bit to be written in the current block.
+  int last[MAX_LOG_FIELDS];  //  Last sample logged, in tenths.
+  bool started = false;  //  True if the current block has been started.
+  uint16_t nextSample = 0;  //  Number of the next sample.
+  uint16_t sentSample = 0;  //  Samples before this number have been sent.
+  uint16_t backfillEnd = 0;  //  Number of the sample after the last one in the backfill message.
+  uint8_t backfillField = 0;  //  First field of the next backfill message, for samples with 3 fields.
+  uint8_t backfillCount = 0;  //  Number of fields in the last backfill message.
+};
+
+#endif  //  UNABIZ_ARDUINO_SAMPLELOG_H
@@ -0,0 +1,236 @@
+//  Library for sampling sensors at different rates and sending the aggregated samples as SIGFOX messages.
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+#include "SIGFOX.h"
+
+static const unsigned long SEND_RETRY = (unsigned long) 60 * 1000;  //  If send failed, retry after 1 minute.
+
+Scheduler::Scheduler(Message &msg0) {
+  //  Send the aggregated samples with this message.
+  msg = &msg0;
+}
+
+int Scheduler::addField(const char *name, Aggregate aggregate) {
+  //  Add a field to be sent.  Returns the field index, or -1 if too many fields.
+  return addField(Message::nameCode(name), aggregate);
+}
+
+int Scheduler::addField(unsigned int nameCode, Aggregate aggregate) {
+  //  Add a field to be sent.  Name was encoded by Message::nameCode().  With sequencing on,
+  //  the message holds one field less, so call Message::setSequence() before adding the fields.
+  const uint8_t space = MAX_BYTES_PER_MESSAGE - (msg->isSequenced() ? SEQUENCE_BYTES : 0);
+  if (fieldCount >= MAX_FIELDS || (fieldCount + 1) * 4 > space) return -1;
+  Field &field = fields[fieldCount];
+  field.nameCode = nameCode;
+  field.aggregate = aggregate;
+  field.count = 0;
+  field.value = 0;
+  return fieldCount++;
+}
+
+int Scheduler::addSensor(unsigned long period, SampleFunc sample) {
+  //  Call the sample function every period milliseconds.  Returns the sensor index, or -1 if too many sensors.
+  if (sensorCount >= MAX_SENSORS || sample == 0) return -1;
+  Sensor &sensor = sensors[sensorCount];
+  sensor.period = period;
+  sensor.nextSample = millis();  //  Sample at the next run.
+  sensor.sample = sample;
+  return sensorCount++;
+}
+
+void Scheduler::record(int index, float value) {
+  //  Record a sample for the field.  Aggregate the samples so we don't need to store them.
+  if (index < 0 || index >= fieldCount) return;
+  Field &field = fields[index];
+  if (field.count == 0) field.value = value;
+  else switch (field.aggregate) {
+    case AGGREGATE_LAST: field.value = value; break;
+    case AGGREGATE_AVERAGE:  //  Sum now, divide when sending.
+    case AGGREGATE_SUM: field.value += value; break;
+    case AGGREGATE_MIN: if (value < field.value) field.value = value; break;
+    case AGGREGATE_MAX: if (value > field.value) field.value = value; break;
+  }
+  if (field.count < 0xffff) field.count++;
+}
+
+void Scheduler::setSendInterval(unsigned long interval) {
+  //  Send every interval milliseconds.  Should be at least SEND_DELAY to comply with the duty cycle.
+  if (started) nextSend = nextSend - sendInterval + interval;
+  sendInterval = interval;
+}
+
+unsigned long Scheduler::getSendInterval() { return sendInterval; }
+
+void Scheduler::setCoalesceWindow(unsigned long window) {
+  //  Timers due within window milliseconds of each other are run together,
+  //  so that the CPU wakes up less often.  Set to 0 to run each timer exactly.
+  coalesceWindow = window;
+}
+
+void Scheduler::requestSend() {
+  //  Send at the next run, without waiting for the send interval, e.g. when an alarm button is pressed.
+  //  To comply with the duty cycle, each requested send uses a send credit.  A credit is earned every
+  //  SEND_DELAY, up to SEND_BURST credits.  If there are no credits, the send waits for the next credit.
+  sendRequested = true;
+}
+
+void Scheduler::setDownlinkPolicy(DownlinkPolicy &policy) {
+  //  Request downlinks with the sends according to this policy.  Without a policy we never request.
+  downlinkPolicy = &policy;
+}
+
+void Scheduler::setSampleLog(SampleLog &log) {
+  //  When a send fails, log the aggregated samples instead of retrying, e.g. out of coverage.
+  //  After the next successful send, the log is backfilled between the sends, using send credits.
+  //  Call log.begin() with the number of fields and log.setNames() with their names first.
+  sampleLog = &log;
+}
+
+bool Scheduler::takeSendCredit() {
+  //  Use a send credit for a message sent outside the scheduler, e.g. an alert.
+  //  Returns false if there are no credits now, so the message should be sent later.
+  addSendCredits(millis());
+  if (sendCredits == 0) return false;
+  sendCredits--;
+  return true;
+}
+
+bool Scheduler::lastSendOK() {
+  //  Return true if the last send succeeded.
+  return sendOK;
+}
+
+bool Scheduler::isDue(unsigned long time, unsigned long now, unsigned long period) {
+  //  Return true if time is now, past or within the coalesce window.  Handles millis() overflow.
+  //  The window is limited to half the period so that fast timers are not run early every time.
+  unsigned long window = coalesceWindow;
+  if (window > period / 2) window = period / 2;
+  return (long) (time - now) <= (long) window;
+}
+
+void Scheduler::addSendCredits(unsigned long now) {
+  //  Earn a send credit for every SEND_DELAY elapsed, up to SEND_BURST credits.
+  const unsigned long earned = (now - creditTime) / SEND_DELAY;
+  if (earned == 0) return;
+  creditTime = creditTime + earned * SEND_DELAY;
+  sendCredits = (sendCredits + earned > SEND_BURST) ? SEND_BURST : sendCredits + earned;
+}
+
+unsigned long Scheduler::run() {
+  //  Sample the sensors that are due, then send the aggregated samples if due.
+  //  Returns the number of milliseconds to wait before calling run() again,
+  //  e.g. delay(scheduler.run());
+  unsigned long now = millis();
+  if (!started) {
+    started = true;
+    nextSend = now + sendInterval;
+    creditTime = now;
+  }
+  for (uint8_t i = 0; i < sensorCount; i++) {
+    Sensor &sensor = sensors[i];
+    if (!isDue(sensor.nextSample, now, sensor.period)) continue;
+    sensor.sample(*this);
+    sensor.nextSample = sensor.nextSample + sensor.period;
+    //  If we fell behind, skip the missed samples instead of sampling repeatedly.
+    if ((long) (sensor.nextSample - now) < 0) sensor.nextSample = now + sensor.period;
+  }
+  addSendCredits(now);
+  const bool requested = sendRequested && sendCredits > 0;
+  if (requested || isDue(nextSend, now, sendInterval)) {
+    //  Periodic sends also use a credit if there is one.  The send restarts the send interval.
+    sendRequested = false;
+    if (sendCredits > 0) sendCredits--;
+    sendOK = send();
+    now = millis();  //  Sending takes a few seconds.
+    //  Samples of a failed send were logged if there is a sample log, so don't retry.
+    nextSend = now + ((sendOK || sampleLog) ? sendInterval : SEND_RETRY);
+    if (sendOK) {
+      nextRepeat = repeatTime(now);
+      nextBackfill = now + (nextSend - now) / 2;
+    }
+  } else if (msg->getRepeatsPending() > 0 && sendCredits > 0 && isDue(nextRepeat, now, sendInterval)) {
+    //  Repeat the last frame if Message::setRepetitions() was set.  Each repeat uses a credit.
+    sendCredits--;
+    const bool repeated = msg->repeat();
+    now = millis();
+    nextRepeat = repeated ? repeatTime(now) : now + SEND_RETRY;
+  } else if (isBackfillPending() && isDue(nextBackfill, now, sendInterval)) {
+    //  Coverage is back, so send a summary of the logged samples between the sends.
+    sampleLog->sendBackfill(*msg, this);
+    now = millis();
+    nextBackfill = now + (nextSend - now) / 2;
+  }
+  //  Wait until the earliest timer is due.
+  unsigned long wait = nextSend - now;
+  if ((long) wait < 0) wait = 0;
+  if (sendRequested) {
+    //  Requested send is waiting for the next send credit.
+    long creditWait = (long) (creditTime + SEND_DELAY - now);
+    if (creditWait < 0) creditWait = 0;
+    if ((unsigned long) creditWait < wait) wait = (unsigned long) creditWait;
+  }
+  if (msg->getRepeatsPending() > 0) {
+    //  Repeat is waiting for its time and a send credit.
+    long repeatWait = (long) (nextRepeat - now);
+    const long creditWait = (long) (creditTime + SEND_DELAY - now);
+    if (sendCredits == 0 && creditWait > repeatWait) repeatWait = creditWait;
+    if (repeatWait < 0) repeatWait = 0;
+    if ((unsigned long) repeatWait < wait) wait = (unsigned long) repeatWait;
+  }
+  if (isBackfillPending()) {
+    //  Backfill is waiting for its time.
+    long backfillWait = (long) (nextBackfill - now);
+    if (backfillWait < 0) backfillWait = 0;
+    if ((unsigned long) backfillWait < wait) wait = (unsigned long) backfillWait;
+  }
+  for (uint8_t i = 0; i < sensorCount; i++) {
+    long sensorWait = (long) (sensors[i].nextSample - now);
+    if (sensorWait < 0) sensorWait = 0;
+    if ((unsigned long) sensorWait < wait) wait = (unsigned long) sensorWait;
+  }
+  return wait;
+}
+
+bool Scheduler::isBackfillPending() {
+  //  Return true if the log has samples to backfill, the last send succeeded, and there is a send credit.
+  return sampleLog && sendOK && sendCredits > 0 && msg->getRepeatsPending() == 0 && sampleLog->getPendingCount() > 0;
+}
+
+unsigned long Scheduler::repeatTime(unsigned long now) {
+  //  Spread the pending repeats evenly until the next send.
+  return now + (nextSend - now) / (msg->getRepeatsPending() + 1);
+}
+
+bool Scheduler::send() {
+  //  Send the aggregated samples.  Clear the samples if sent successfully.  Fields that don't fit,
+  //  because sequencing was turned on after they were added, are dropped instead of failing every send.
+  //  If the send fails and there is a sample log, the samples are logged and cleared.  Fields
+  //  without samples are logged as 0.
+  msg->reset();
+  bool hasFields = false;  bool fits = true;
+  float values[MAX_FIELDS] = {};
+  for (uint8_t i = 0; i < fieldCount; i++) {
+    Field &field = fields[i];
+    if (field.count == 0 && field.aggregate != AGGREGATE_SUM) continue;  //  No samples.
+    float value = field.value;
+    if (field.aggregate == AGGREGATE_AVERAGE) value = value / field.count;
+    values[i] = value;
+    if (fits) fits = msg->addField(field.nameCode, value);
+    if (fits) hasFields = true;
+  }
+  if (!hasFields) return false;
+  const bool sent = downlinkPolicy ? downlinkPolicy->send(*msg) : msg->send();
+  if (!sent && !sampleLog) return false;
+  if (!sent) sampleLog->append(values);
+  for (uint8_t i = 0; i < fieldCount; i++) {
+    fields[i].count = 0;
+    fields[i].value = 0;
+  }
+  return sent;
+}
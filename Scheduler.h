@@ -0,0 +1,90 @@
+//  Library for sampling sensors at different rates and sending the aggregated samples as SIGFOX messages.
+#ifndef UNABIZ_ARDUINO_SCHEDULER_H
+#define UNABIZ_ARDUINO_SCHEDULER_H
+
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+const uint8_t MAX_SENSORS = 4;  //  Max number of sensors that may be sampled.
+const uint8_t MAX_FIELDS = MAX_BYTES_PER_MESSAGE / 4;  //  Max number of fields in a message, 4 bytes each.
+const unsigned long COALESCE_WINDOW = 100;  //  Timers due within 100 milliseconds are run together.
+const uint8_t SEND_BURST = 3;  //  Max number of requested sends allowed within SEND_DELAY.
+
+//  How the samples for a field are aggregated into the value sent.
+enum Aggregate {
+  AGGREGATE_LAST = 0,  //  Send the last sample.
+  AGGREGATE_AVERAGE = 1,  //  Send the average of the samples.
+  AGGREGATE_MIN = 2,  //  Send the smallest sample.
+  AGGREGATE_MAX = 3,  //  Send the largest sample.
+  AGGREGATE_SUM = 4,  //  Send the sum of the samples, e.g. number of button presses.
+};
+
+class Scheduler;
+class DownlinkPolicy;
+class SampleLog;
+
+//  Function to sample a sensor.  Should call scheduler.record() for each field sampled.
+typedef void (*SampleFunc)(Scheduler &scheduler);
+
+class Scheduler
+{
+public:
+  Scheduler(Message &msg);  //  Send the aggregated samples with this message.
+  int addField(const char *name, Aggregate aggregate);  //  Add a field to be sent.  Returns the field index, or -1 if too many.
+  int addField(unsigned int nameCode, Aggregate aggregate);  //  Same as above, name encoded by Message::nameCode().
+  int addSensor(unsigned long period, SampleFunc sample);  //  Sample every period milliseconds.  Returns the sensor index, or -1 if too many.
+  void record(int field, float value);  //  Record a sample for the field.  Called by the sample function.
+  void setSendInterval(unsigned long interval);  //  Send every interval milliseconds.  Defaults to SEND_DELAY.
+  unsigned long getSendInterval();  //  Return the send interval in milliseconds.
+  void setCoalesceWindow(unsigned long window);  //  Run timers due within window milliseconds together.
+  void requestSend();  //  Send at the next run, without waiting for the send interval, if the duty cycle allows.
+  void setDownlinkPolicy(DownlinkPolicy &policy);  //  Request downlinks with the sends according to this policy.
+  void setSampleLog(SampleLog &log);  //  Log the samples of failed sends, and backfill them after the next send.
+  bool takeSendCredit();  //  Use a send credit for a message sent outside the scheduler.  Returns false if none.
+  unsigned long run();  //  Sample the sensors and send if due.  Returns the milliseconds to wait until the next run.
+  bool lastSendOK();  //  Return true if the last send succeeded.
+
+private:
+  bool isDue(unsigned long time, unsigned long now, unsigned long period);  //  Return true if time is now or within the coalesce window.
+  void addSendCredits(unsigned long now);  //  Earn a send credit for every SEND_DELAY elapsed.
+  bool send();  //  Send the aggregated samples and clear them.
+  unsigned long repeatTime(unsigned long now);  //  Return the time of the next repeat of the last frame.
+  bool isBackfillPending();  //  Return true if logged samples may be backfilled now.
+
+  struct Sensor {
+    unsigned long period;  //  Sample every period milliseconds.
+    unsigned long nextSample;  //  Time of the next sample.
+    SampleFunc sample;  //  Function to sample the sensor.
+  };
+  struct Field {
+    unsigned int nameCode;  //  Name encoded by Message::nameCode().
+    Aggregate aggregate;  //  How the samples are aggregated.
+    uint16_t count;  //  Number of samples since the last send.
+    float value;  //  Last, min, max or sum of samples since the last send.
+  };
+
+  Message *msg;  //  Message for sending the aggregated samples.
+  DownlinkPolicy *downlinkPolicy = 0;  //  Decides which sends request a downlink.
+  SampleLog *sampleLog = 0;  //  Logs the samples that couldn't be sent.
+  Sensor sensors[MAX_SENSORS];
+  Field fields[MAX_FIELDS];
+  uint8_t sensorCount = 0;
+  uint8_t fieldCount = 0;
+  unsigned long sendInterval = SEND_DELAY;  //  Send every interval milliseconds.
+  unsigned long nextSend = 0;  //  Time of the next send.
+  unsigned long nextRepeat = 0;  //  Time of the next repeat of the last frame.
+  unsigned long nextBackfill = 0;  //  Time of the next backfill message from the sample log.
+  unsigned long coalesceWindow = COALESCE_WINDOW;  //  Timers due within the window are run together.
+  bool started = false;  //  True after the first run.
+  bool sendRequested = false;  //  True if requestSend() was called.
+  bool sendOK = false;  //  True if the last send succeeded.
+  uint8_t sendCredits = SEND_BURST;  //  Number of requested sends allowed now.
+  unsigned long creditTime = 0;  //  Time the last send credit was earned.
+};
+
+#endif  //  UNABIZ_ARDUINO_SCHEDULER_H
@@ -0,0 +1,78 @@
+//  Library for storing data that must survive resets, in the EEPROM of the Arduino.
+//  Under Windows or Mac without Arduino, the EEPROM is simulated in memory.
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+  #include <avr/eeprom.h>
+#endif  //  ARDUINO
+
+#include "SIGFOX.h"
+
+#ifndef ARDUINO
+//  Simulated EEPROM.  Erased EEPROM reads as 0xff.
+static uint8_t eeprom[EEPROM_SIZE];
+static bool eepromErased = false;
+
+static void eraseEEPROM() {
+  if (eepromErased) return;
+  for (unsigned int i = 0; i < EEPROM_SIZE; i++) eeprom[i] = 0xff;
+  eepromErased = true;
+}
+#endif  //  ARDUINO
+
+uint8_t Storage::read(unsigned int address) {
+  //  Read a byte.
+  if (address >= EEPROM_SIZE) return 0xff;
+#ifdef ARDUINO
+  return eeprom_read_byte((const uint8_t *) address);
+#else  //  ARDUINO
+  eraseEEPROM();
+  return eeprom[address];
+#endif  //  ARDUINO
+}
+
+void Storage::write(unsigned int address, uint8_t value) {
+  //  Write a byte.  EEPROM wears out after 100,000 writes, so we write only if changed.
+  if (address >= EEPROM_SIZE) return;
+#ifdef ARDUINO
+  eeprom_update_byte((uint8_t *) address, value);
+#else  //  ARDUINO
+  eraseEEPROM();
+  eeprom[address] = value;
+#endif  //  ARDUINO
+}
+
+uint16_t Storage::readWord(unsigned int address) {
+  //  Read 2 bytes, least significant first.
+  return read(address) | ((uint16_t) read(address + 1) << 8);
+}
+
+void Storage::writeWord(unsigned int address, uint16_t value) {
+  //  Write 2 bytes, least significant first.
+  write(address, value & 0xff);
+  write(address + 1, value >> 8);
+}
+
+static uint16_t hashID(const String &id) {
+  //  Hash the module ID, so that we configure the zone again if the module is replaced.
+  uint16_t hash = 0;
+  for (unsigned int i = 0; i < id.length(); i++) hash = hash * 31 + (uint8_t) id.charAt(i);
+  return hash;
+}
+
+bool Storage::isZoneSaved(uint8_t zone, const String &id) {
+  //  Return true if the zone was written to the module with this ID, so that
+  //  begin() may skip the frequency commands after the first boot.
+  return read(EEPROM_ZONE) == ZONE_MARKER && read(EEPROM_ZONE + 1) == zone &&
+         readWord(EEPROM_ZONE + 2) == hashID(id);
+}
+
+void Storage::saveZone(uint8_t zone, const String &id) {
+  //  Remember that the zone was verified or written to the module with this ID.
+  write(EEPROM_ZONE, ZONE_MARKER);
+  write(EEPROM_ZONE + 1, zone);
+  writeWord(EEPROM_ZONE + 2, hashID(id));
+}
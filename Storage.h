@@ -0,0 +1,36 @@
+//  Library for storing data that must survive resets, in the EEPROM of the Arduino.
+//  Under Windows or Mac without Arduino, the EEPROM is simulated in memory.
+#ifndef UNABIZ_ARDUINO_STORAGE_H
+#define UNABIZ_ARDUINO_STORAGE_H
+
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+//  Layout of the EEPROM used by the SIGFOX library.  Arduino Uno has 1024 bytes of EEPROM.
+const unsigned int EEPROM_SIZE = 1024;  //  Bytes of EEPROM used by the library.
+const unsigned int EEPROM_SEQUENCE = 0;  //  Message sequence number.
+const unsigned int EEPROM_SEQUENCE_SIZE = 32;
+const unsigned int EEPROM_CONFIG = 32;  //  Transceiver configuration.
+const unsigned int EEPROM_CONFIG_SIZE = 32;
+const unsigned int EEPROM_ZONE = EEPROM_CONFIG;  //  Zone written to the module: marker, zone, 2 bytes hash of the module ID.
+const uint8_t ZONE_MARKER = 0x5a;  //  Marks a saved zone.  Erased EEPROM reads as 0xff.
+const unsigned int EEPROM_LOG = 64;  //  Sample log.
+const unsigned int EEPROM_LOG_SIZE = EEPROM_SIZE - EEPROM_LOG;
+
+class Storage
+{
+public:
+  static uint8_t read(unsigned int address);  //  Read a byte.
+  static void write(unsigned int address, uint8_t value);  //  Write a byte, only if changed to reduce the wear.
+  static uint16_t readWord(unsigned int address);  //  Read 2 bytes, least significant first.
+  static void writeWord(unsigned int address, uint16_t value);  //  Write 2 bytes, least significant first.
+  static bool isZoneSaved(uint8_t zone, const String &id);  //  Return true if the zone was written to the module with this ID.
+  static void saveZone(uint8_t zone, const String &id);  //  Remember that the zone was written to the module.
+};
+
+#endif  //  UNABIZ_ARDUINO_STORAGE_H
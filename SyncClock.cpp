@@ -0,0 +1,123 @@
+//  Library for keeping the real time, synchronized by a downlink from the server.
+//  millis() drifts and restarts at reboot, so the server can only timestamp our data by the
+//  time received.  SyncClock sets the time from a time sync downlink, measures the drift of
+//  millis() between syncs and corrects for it, so that we may send the time of past samples.
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+#include "SIGFOX.h"
+
+static const long PPM = 1000000;  //  Parts per million.
+
+SyncClock::SyncClock() {
+  lastMillis = millis();
+}
+
+bool SyncClock::handleDownlink(const String &response) {
+  //  Sync from the downlink response if it's a time sync command.  Returns true if synced.
+  //  The server should send the time when the downlink is sent, which arrives within seconds.
+  if (response.length() < 10 || DownlinkPolicy::hexByte(response, 0) != TIME_SYNC_COMMAND) return false;
+  unsigned long unixTime = 0;
+  for (unsigned int pos = 2; pos < 10; pos += 2) {
+    const int b = DownlinkPolicy::hexByte(response, pos);
+    if (b < 0) return false;
+    unixTime = (unixTime << 8) | (unsigned long) b;
+  }
+  sync(unixTime);
+  return true;
+}
+
+void SyncClock::sync(unsigned long unixTime) {
+  //  Set the time in seconds since 1 Jan 1970 UTC.  If the last sync was long enough ago,
+  //  compare the real time elapsed with the local time elapsed to measure the drift.
+  //  millis() and the watchdog drift differently, so each sync measures the drift of the
+  //  time source that ran for most of the interval, after removing the time of the other
+  //  source corrected by its own drift.
+  update();
+  if (synced) {
+    const int64_t real = ((int64_t) unixTime - (int64_t) syncTime) * 1000;
+    if (localSinceSync >= sleepSinceSync)
+      measureDrift(drift, driftMeasured, real - correctSleep(sleepSinceSync), localSinceSync);
+    else
+      measureDrift(sleepDrift, sleepDriftMeasured, real - correct(localSinceSync), sleepSinceSync);
+  }
+  realMs = (uint64_t) unixTime * 1000;
+  syncTime = unixTime;
+  localSinceSync = 0;
+  sleepSinceSync = 0;
+  synced = true;
+}
+
+void SyncClock::measureDrift(long &drift, bool &measured, int64_t real, unsigned long local) {
+  //  Update the drift of a time source that counted local ms while real ms passed.
+  if (local < MIN_DRIFT_INTERVAL) return;
+  const long result = (long) ((real - (int64_t) local) * PPM / (int64_t) local);
+  if (result <= -MAX_DRIFT || result >= MAX_DRIFT) return;
+  //  Average with the previous drift to smooth the error of the sync time.
+  drift = measured ? (drift + result) / 2 : result;
+  measured = true;
+}
+
+bool SyncClock::isSynced() { return synced; }
+
+void SyncClock::update() {
+  //  Add the millis() elapsed since the last update.  Handles millis() overflow
+  //  if called at least every 49 days, e.g. by now().
+  const unsigned long current = millis();
+  const unsigned long ms = current - lastMillis;
+  realMs += correct(ms);
+  localSinceSync += ms;
+  lastMillis = current;
+}
+
+unsigned long SyncClock::now() {
+  //  Return the time in seconds since 1 Jan 1970 UTC, or 0 if not synced.
+  update();
+  if (!synced) return 0;
+  return (unsigned long) (realMs / 1000);
+}
+
+void SyncClock::addSleep(unsigned long ms) {
+  //  Add the time slept while millis() was stopped, e.g. in power down woken by the watchdog.
+  //  The watchdog timer drifts more than millis(), so pass the nominal time and we correct it
+  //  by the drift measured for the watchdog.
+  realMs += correctSleep(ms);
+  sleepSinceSync += ms;
+}
+
+unsigned long SyncClock::correct(unsigned long ms) {
+  //  Correct a duration measured by millis() for the measured drift.
+  return applyDrift(ms, drift);
+}
+
+unsigned long SyncClock::correctSleep(unsigned long ms) {
+  //  Correct a duration measured by the watchdog for the measured drift.
+  return applyDrift(ms, sleepDrift);
+}
+
+unsigned long SyncClock::applyDrift(unsigned long ms, long drift) {
+  return (unsigned long) ((int64_t) ms + (int64_t) ms * drift / PPM);
+}
+
+long SyncClock::getDrift() { return drift; }
+
+long SyncClock::getSleepDrift() { return sleepDrift; }
+
+int SyncClock::ageInMinutes(unsigned long unixTime) {
+  //  Return the minutes from the time to now, from 0 to 3276 so that it fits into a message field.
+  const unsigned long current = now();
+  if (!synced || unixTime >= current) return 0;
+  const unsigned long minutes = (current - unixTime) / 60;
+  return (minutes > 3276) ? 3276 : (int) minutes;
+}
+
+bool SyncClock::addAge(Message &msg, unsigned long unixTime) {
+  //  Add the age of a sample in minutes to the message, so that the server can compute the
+  //  time of the sample from the time received.  Takes 4 bytes instead of a full timestamp.
+  return msg.addField(Message::nameCode("age"), ageInMinutes(unixTime));
+}
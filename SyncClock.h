@@ -0,0 +1,55 @@
+//  Library for keeping the real time, synchronized by a downlink from the server.
+//  millis() drifts and restarts at reboot, so the server can only timestamp our data by the
+//  time received.  SyncClock sets the time from a time sync downlink, measures the drift of
+//  millis() and the watchdog between syncs and corrects for it, so that we may send the time of past samples.
+#ifndef UNABIZ_ARDUINO_SYNCCLOCK_H
+#define UNABIZ_ARDUINO_SYNCCLOCK_H
+
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+//  Time sync downlink: 8 bytes as 16 hex digits.  Byte 0 is the command,
+//  bytes 1 to 4 are the Unix time in seconds, most significant byte first.  The rest are ignored.
+const uint8_t TIME_SYNC_COMMAND = 0x01;
+const unsigned long MIN_DRIFT_INTERVAL = (unsigned long) 60 * 60 * 1000;  //  Syncs must be 1 hour apart to measure the drift.
+const long MAX_DRIFT = 50000;  //  Ignore drift beyond 5%, it's a wrong time sync.
+
+class SyncClock
+{
+public:
+  SyncClock();
+  bool handleDownlink(const String &response);  //  Sync from the downlink if it's a time sync.  Returns true if synced.
+  void sync(unsigned long unixTime);  //  Set the time in seconds since 1 Jan 1970 UTC.
+  bool isSynced();  //  Return true if the time has been set.
+  unsigned long now();  //  Return the time in seconds since 1 Jan 1970 UTC, or 0 if not synced.
+  void addSleep(unsigned long ms);  //  Add the time slept while millis() was stopped, e.g. in power down.
+  unsigned long correct(unsigned long ms);  //  Correct a duration measured by millis() for the drift.
+  unsigned long correctSleep(unsigned long ms);  //  Correct a duration measured by the watchdog for the drift.
+  long getDrift();  //  Return the measured drift of millis() in parts per million.  Positive if millis() is slow.
+  long getSleepDrift();  //  Return the measured drift of the watchdog in parts per million.  Positive if it's slow.
+  int ageInMinutes(unsigned long unixTime);  //  Return the minutes from the time to now, up to 3276.
+  bool addAge(Message &msg, unsigned long unixTime);  //  Add the age of a sample in minutes to the message as "age".
+
+private:
+  void update();  //  Add the millis() elapsed since the last update.  Call at least every 49 days.
+  static void measureDrift(long &drift, bool &measured, int64_t real, unsigned long local);  //  Update the drift of one time source.
+  static unsigned long applyDrift(unsigned long ms, long drift);  //  Correct ms for the drift in parts per million.
+
+  bool synced = false;  //  True after the first sync.
+  uint64_t realMs = 0;  //  Real time in milliseconds since 1 Jan 1970 UTC, at lastMillis.
+  unsigned long lastMillis = 0;  //  millis() at the last update.
+  unsigned long syncTime = 0;  //  Unix time of the last sync.
+  unsigned long localSinceSync = 0;  //  millis() elapsed since the last sync, not corrected.
+  unsigned long sleepSinceSync = 0;  //  Watchdog time slept since the last sync, not corrected.
+  long drift = 0;  //  Parts per million that millis() is slow.
+  long sleepDrift = 0;  //  Parts per million that the watchdog is slow.
+  bool driftMeasured = false;  //  True after the drift of millis() has been measured once.
+  bool sleepDriftMeasured = false;  //  True after the drift of the watchdog has been measured once.
+};
+
+#endif  //  UNABIZ_ARDUINO_SYNCCLOCK_H
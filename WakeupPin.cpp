@@ -0,0 +1,121 @@
+//  Library for waking up the Arduino when a button or alarm pin is triggered, and requesting an
+//  immediate SIGFOX message through the Scheduler.  The pin is watched by an interrupt and debounced
+//  in the interrupt handler, so we may sleep instead of polling the pin.
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+  #ifdef __AVR__
+    #include <avr/sleep.h>
+  #endif  //  __AVR__
+#endif  //  ARDUINO
+
+#include "SIGFOX.h"
+
+static WakeupPin *activePin = 0;  //  The pin watched by the interrupt.
+
+WakeupPin::WakeupPin(uint8_t pin0) {
+  pin = pin0;
+}
+
+bool WakeupPin::begin() {
+  //  Start watching the pin.  Returns false if the pin doesn't support interrupts.
+  activePin = this;
+#ifdef ARDUINO
+  if (digitalPinToInterrupt(pin) == NOT_AN_INTERRUPT) return false;
+  pinMode(pin, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(pin), handleInterrupt, CHANGE);
+#endif  //  ARDUINO
+  return true;
+}
+
+void WakeupPin::setScheduler(Scheduler &scheduler0, int field0) {
+  //  When triggered, record the number of triggers in the field and request a send.
+  //  The field should be added with AGGREGATE_SUM.
+  scheduler = &scheduler0;
+  field = field0;
+}
+
+uint8_t WakeupPin::poll() {
+  //  Return the number of triggers since the last poll.  If there is a scheduler,
+  //  record the triggers and request a send, which bypasses the send interval
+  //  but still complies with the duty cycle.  Call this before scheduler.run().
+#ifdef ARDUINO
+  noInterrupts();
+#endif  //  ARDUINO
+  const uint8_t count = triggerCount;
+  triggerCount = 0;
+#ifdef ARDUINO
+  interrupts();
+#endif  //  ARDUINO
+  if (count > 0 && scheduler) {
+    scheduler->record(field, count);
+    scheduler->requestSend();
+  }
+  return count;
+}
+
+void WakeupPin::sleep(unsigned long ms) {
+  //  Sleep for ms milliseconds, or until the pin is triggered.  Uses the idle sleep mode so that
+  //  millis() and SoftwareSerial still work.  The timer wakes us every millisecond to check the time.
+  //  e.g. button.sleep(scheduler.run());
+#if defined(ARDUINO) && defined(__AVR__)
+  const unsigned long start = millis();
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  while (millis() - start < ms) {
+    noInterrupts();
+    if (triggerCount > 0) { interrupts(); return; }
+    sleep_enable();
+    interrupts();  //  The next instruction always runs, so we can't miss the interrupt before sleeping.
+    sleep_cpu();
+    sleep_disable();
+  }
+#else  //  ARDUINO && __AVR__
+  if (triggerCount == 0) delay(ms);
+#endif  //  ARDUINO && __AVR__
+}
+
+void WakeupPin::sleepUntilTriggered() {
+  //  Sleep with the lowest power until the pin is triggered.  Only the LOW level of the pin
+  //  can wake the Arduino from power down, so we watch the level while sleeping.
+  //  millis() stops while sleeping, so use this only if we send when triggered and not periodically.
+#if defined(ARDUINO) && defined(__AVR__)
+  const uint8_t interrupt = digitalPinToInterrupt(pin);
+  noInterrupts();
+  if (triggerCount > 0) { interrupts(); return; }
+  sleeping = true;
+  attachInterrupt(interrupt, handleInterrupt, LOW);
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_enable();
+  interrupts();
+  sleep_cpu();
+  sleep_disable();
+  //  Woken by the pin.  Watch the pin changes again.
+  attachInterrupt(interrupt, handleInterrupt, CHANGE);
+#endif  //  ARDUINO && __AVR__
+}
+
+void WakeupPin::handleInterrupt() {
+  //  Called by the interrupt when the pin changes.  Count a trigger when the pin goes LOW,
+  //  ignoring the bounces within DEBOUNCE_DELAY of the last change.
+  WakeupPin *p = activePin;
+  if (p == 0) return;
+  const unsigned long now = millis();
+#ifdef ARDUINO
+  if (p->sleeping) {
+    //  Woken from power down.  Stop the LOW level interrupt, else it will repeat while the pin is LOW.
+    detachInterrupt(digitalPinToInterrupt(p->pin));
+    p->sleeping = false;
+    if (p->triggerCount < 0xff) p->triggerCount++;
+    p->lastChange = now;
+    return;
+  }
+  const bool triggered = digitalRead(p->pin) == LOW;
+#else  //  ARDUINO
+  const bool triggered = true;  //  For testing: every call is a trigger.
+#endif  //  ARDUINO
+  if (triggered && now - p->lastChange >= DEBOUNCE_DELAY && p->triggerCount < 0xff) p->triggerCount++;
+  p->lastChange = now;
+}
@@ -0,0 +1,41 @@
+//  Library for waking up the Arduino when a button or alarm pin is triggered, and requesting an
+//  immediate SIGFOX message through the Scheduler.  The pin is watched by an interrupt and debounced
+//  in the interrupt handler, so we may sleep instead of polling the pin.
+#ifndef UNABIZ_ARDUINO_WAKEUPPIN_H
+#define UNABIZ_ARDUINO_WAKEUPPIN_H
+
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+const unsigned long DEBOUNCE_DELAY = 50;  //  Ignore pin changes within 50 milliseconds of the last change.
+
+//  Only one WakeupPin may be active because the interrupt handler is shared.
+//  The pin must support attachInterrupt(), e.g. D2 or D3 on Arduino Uno.  Pin change interrupts
+//  can't be used because SoftwareSerial, which talks to the SIGFOX module, uses all of them.
+//  The pin is triggered when LOW, e.g. a button that connects the pin to GND.
+class WakeupPin
+{
+public:
+  WakeupPin(uint8_t pin);  //  Watch this pin.  The internal pull-up resistor is enabled.
+  bool begin();  //  Start watching the pin.  Returns false if the pin doesn't support interrupts.
+  void setScheduler(Scheduler &scheduler, int field);  //  When triggered, record 1 in the field and request a send.
+  uint8_t poll();  //  Return the number of triggers since the last poll, and pass them to the scheduler.
+  void sleep(unsigned long ms);  //  Sleep for ms milliseconds, or until the pin is triggered.
+  void sleepUntilTriggered();  //  Sleep with the lowest power until the pin is triggered.  millis() will stop.
+  static void handleInterrupt();  //  Called by the interrupt when the pin changes.
+
+private:
+  uint8_t pin;  //  Pin to watch.
+  Scheduler *scheduler = 0;  //  Scheduler to request the send.
+  int field = -1;  //  Scheduler field to record the triggers.
+  volatile uint8_t triggerCount = 0;  //  Number of triggers since the last poll.  Updated by the interrupt.
+  volatile unsigned long lastChange = 0;  //  Time of the last pin change, for debouncing.
+  volatile bool sleeping = false;  //  True while sleeping until triggered.
+};
+
+#endif  //  UNABIZ_ARDUINO_WAKEUPPIN_H
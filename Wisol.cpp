@@ -17,23 +17,25 @@
 
 #define MODEM_BITS_PER_SECOND 9600  //  Connect to modem at this bps.
 #define END_OF_RESPONSE '\r'  //  Character '\r' marks the end of response.
-#define CMD_OUTPUT_POWER_MAX "ATS302=15"  //  For RCZ1: Set output power to maximum power level.
+#define CMD_OUTPUT_POWER "ATS302="  //  For RCZ1, 3: Set output power in dBm.
+#define CMD_GET_OUTPUT_POWER "ATS302?"  //  Get output power in dBm.
 #define CMD_PRESEND "AT$GI?"  //  For RCZ2, 4: Send this command before sending messages.  Returns X,Y.
 #define CMD_PRESEND2 "AT$RC"  //  For RCZ2, 4: Send this command if presend returns X=0 or Y<3.
 #define CMD_SEND_MESSAGE "AT$SF="  //  Prefix to send a message to SIGFOX cloud.
 #define CMD_SEND_MESSAGE_RESPONSE ",1"  //  Expect downlink response from SIGFOX.
+#define CMD_SEND_BIT "AT$SB="  //  Prefix to send a single bit to SIGFOX cloud.
 #define CMD_GET_ID "AT$I=10"  //  Get SIGFOX device ID.
 #define CMD_GET_PAC "AT$I=11"  //  Get SIGFOX device PAC, used for registering the device.
 #define CMD_GET_TEMPERATURE "AT$T?"  //  Get the module temperature.
 #define CMD_GET_VOLTAGE "AT$V?"  //  Get the module voltage.
+#define CMD_SEND_OUT_OF_BAND "AT$SO"  //  Send an out-of-band frame with the module voltage and temperature.
 #define CMD_RESET "AT$P=0"  //  Software reset.
 #define CMD_SLEEP "AT$P=1"  //  TODO: Switch to sleep mode : consumption is < 1.5uA
 #define CMD_WAKEUP "AT$P=0"  //  TODO: Switch back to normal mode : consumption is 0.5 mA
 #define CMD_END "\r"
-#define CMD_RCZ1 "AT$IF=868130000"  //  EU / RCZ1 Frequency
-#define CMD_RCZ2 "AT$IF=902200000"  //  US / RCZ2 Frequency
-#define CMD_RCZ3 "AT$IF=902080000"  //  JP / RCZ3 Frequency
-#define CMD_RCZ4 "AT$IF=920800000"  //  RCZ4 Frequency
+#define CMD_GET_FREQUENCY "AT$IF?"  //  Get the uplink frequency in Hz.
+#define CMD_WRITE_SETTINGS "AT$WR"  //  Save the settings to the module flash.
+#define CMD_SET_FREQUENCY "AT$IF="  //  Set the uplink frequency in Hz, from the zone profile.
 #define CMD_MODULATION_ON "AT$CB=-1,1"  //  Modulation wave on.
 #define CMD_MODULATION_OFF "AT$CB=-1,0"  //  Modulation wave off.
 
@@ -45,27 +47,26 @@ static String data;
 const uint8_t markerPosMax = 5;
 static uint8_t markerPos[markerPosMax];
 
-bool Wisol::sendBuffer(const String &buffer, const int timeout,
+bool Wisol::sendBuffer(const String &buffer, const unsigned long timeout,
                        uint8_t expectedMarkerCount, String &response,
-                       uint8_t &actualMarkerCount) {
+                       uint8_t &actualMarkerCount, bool keepOpen) {
   //  buffer contains a string of ASCII chars to be sent to the modem.
   //  We send the buffer to the modem.  Return true if successful.
   //  expectedMarkerCount is the number of end-of-command markers '\r' we
   //  expect to see.  actualMarkerCount contains the actual number seen.
   log2(F(" - Wisol.sendBuffer: "), buffer);
   response = "";
+  if (downlinkPending) {
+    //  Restarting the serial port would lose the downlink.
+    log1(F(" - Wisol.sendBuffer: Error: Waiting for downlink"));
+    return false;
+  }
   if (useEmulator) return true;
 
   actualMarkerCount = 0;
-  //  Start serial interface.
-  serialPort->begin(MODEM_BITS_PER_SECOND);
-#ifdef BEAN_BEAN_BEAN_H
-  Bean.sleep(200);
-#else  // BEAN_BEAN_BEAN_H
-  delay(200);
-#endif // BEAN_BEAN_BEAN_H
-  serialPort->flush();
-  serialPort->listen();
+  openPort();
+  lastCommand = buffer;
+  lastCommand.trim();
 
   //  Send the buffer: need to write/read char by char because of echo.
   const char *rawBuffer = buffer.c_str();
@@ -108,7 +109,7 @@ bool Wisol::sendBuffer(const String &buffer, const int timeout,
       }
     }
   }
-  serialPort->end();
+  if (!keepOpen || actualMarkerCount < expectedMarkerCount) serialPort->end();
   //  Log the actual bytes sent and received.
   //log2(F(">> "), echoSend);
   //  if (echoReceive.length() > 0) { log2(F("<< "), echoReceive); }
@@ -128,6 +129,95 @@ bool Wisol::sendBuffer(const String &buffer, const int timeout,
   return true;
 }
 
+void Wisol::openPort() {
+  //  Start serial interface and discard any late response before sending.  The port is ended
+  //  between sessions, so bytes sent by the module while it's closed are lost.  Only bytes that
+  //  arrive during the 200 ms after begin() are drained, e.g. a response still on its way when
+  //  the last command timed out and we retry at once.
+  serialPort->begin(MODEM_BITS_PER_SECOND);
+#ifdef BEAN_BEAN_BEAN_H
+  Bean.sleep(200);
+#else  // BEAN_BEAN_BEAN_H
+  delay(200);
+#endif // BEAN_BEAN_BEAN_H
+  serialPort->flush();
+  serialPort->listen();
+  drainLateResponse();
+}
+
+bool Wisol::sendCommands(const String commands[], uint8_t count, String responses[]) {
+  //  Send independent read-only commands, e.g. ID and PAC, in one session.  Each command is
+  //  written as soon as the '\r' of the previous response arrives, and responses[i] returns
+  //  the response to commands[i].  Saves the port restart of each command.  The module
+  //  sends nothing until the command ends, so the command is written without the delay
+  //  after each char.  Commands don't include CMD_END.  Returns false if any command times out
+  //  or returns an error like "ERR_SFX-ERR_...", and doesn't send the commands after it.
+  for (uint8_t i = 0; i < count; i++) responses[i] = "";
+  if (downlinkPending) {
+    log1(F(" - Wisol.sendCommands: Error: Waiting for downlink"));
+    return false;
+  }
+  if (useEmulator) return true;
+  openPort();
+  bool ok = true;
+  for (uint8_t i = 0; ok && i < count; i++) {
+    lastCommand = commands[i];
+    serialPort->print(commands[i] + CMD_END);
+    ok = false;
+    const unsigned long startTime = millis();
+    while (millis() - startTime <= COMMAND_TIMEOUT) {
+      if (serialPort->available() <= 0) continue;
+      const int rxChar = serialPort->read();
+      if (rxChar == -1 || rxChar == '\n') continue;
+      if (rxChar == END_OF_RESPONSE) { ok = true; break; }
+      responses[i].concat((char) rxChar);
+    }
+    log4(F(">> "), commands[i], F(" << "), responses[i]);
+    if (!ok) {
+      log2(F(" - Wisol.sendCommands: Error: No response to "), lastCommand);
+    } else if (responses[i].startsWith("ERR")) {
+      log4(F(" - Wisol.sendCommands: Error: "), lastCommand, F(" returned "), responses[i]);
+      ok = false;
+    }
+  }
+  serialPort->end();
+  return ok;
+}
+
+void Wisol::drainLateResponse() {
+  //  Read the bytes that arrived since openPort() started the port, so that the next command
+  //  doesn't take them as its response.  Bytes sent while the port was ended are not seen.
+  String late;
+  while (serialPort->available() > 0) {
+    const int rxChar = serialPort->read();
+    if (rxChar == -1) break;
+    late.concat((char) rxChar);
+  }
+  classifyLateResponse(late);
+}
+
+void Wisol::classifyLateResponse(String late) {
+  //  Count the bytes drained before a command.  A late "OK", "ERR" or "RX=" line is the
+  //  response to the last command.  Anything else is noise.
+  if (late.length() == 0) return;
+  late.trim();
+  if (late.indexOf("OK") >= 0 || late.indexOf("ERR") >= 0 || late.indexOf("RX=") >= 0) {
+    lateResponses++;
+    log4(F(" - Wisol.sendBuffer: Late response to "), lastCommand, F(": "), late);
+  } else {
+    strayBytes += late.length();
+    log2(F(" - Wisol.sendBuffer: Discarded stray bytes: "), late);
+  }
+}
+
+uint16_t Wisol::getLateResponses() { return lateResponses; }
+
+uint16_t Wisol::getStrayBytes() { return strayBytes; }
+
+uint16_t Wisol::getChannelQueries() { return fccQueries; }
+
+uint16_t Wisol::getChannelResets() { return fccResets; }
+
 bool Wisol::sendMessage(const String &payload) {
   //  Payload contains a string of hex digits, up to 24 digits / 12 bytes.
   //  We prefix with AT$SF= and send to SIGFOX.  Return true if successful.
@@ -144,55 +234,157 @@ bool Wisol::sendMessage(const String &payload) {
     lastSend = millis();
     return true;
   }
+  fccKnown = false;  //  Frames may have been sent anyway, so query the macro channel before the next send.
   return false;
 }
 
 bool Wisol::sendMessageAndGetResponse(const String &payload, String &response) {
   //  Payload contains a string of hex digits, up to 24 digits / 12 bytes.
   //  We prefix with AT$SF= and send to SIGFOX.  Return response message from Sigfox in the response parameter.
-  log2(F(" - Wisol.sendMessageAndGetResponse: "), device + ',' + payload);
+  //  Blocks until the downlink is received or the downlink window closes.
+  if (!startMessageAndGetResponse(payload)) return false;
+  for (;;) {
+    const DownlinkStatus status = pollResponse(response);
+    if (status == DOWNLINK_RECEIVED) return true;
+    if (status != DOWNLINK_PENDING) return false;
+  }
+}
+
+bool Wisol::startMessageAndGetResponse(const String &payload) {
+  //  Send the payload with a downlink request and return as soon as the module confirms
+  //  the uplink with "OK".  The serial port stays open and SoftwareSerial buffers the
+  //  downlink in its receive interrupt, so we may sample sensors during the 20 to 45 seconds
+  //  until the downlink window closes.  Call pollResponse() often to collect the downlink,
+  //  before the receive buffer overflows.  Other module commands fail until then.
+  log2(F(" - Wisol.startMessageAndGetResponse: "), device + ',' + payload);
   if (!isReady()) return false;  //  Prevent user from sending too many messages.
   //  Exit command mode and prepare to send message.
   if (!exitCommandMode()) return false;
   //  Set the output power for the zone.
   if (!setOutputPower()) return false;
-  //  Send the data.
+  //  Send the data.  One '\r' marker expected ("OK\r") before the downlink window opens.
   String message = String(CMD_SEND_MESSAGE) + payload + CMD_SEND_MESSAGE_RESPONSE + CMD_END, data;
-  //  Two '\r' markers expected ("OK\r RX=...\r").
-  if (sendBuffer(message, WISOL_COMMAND_TIMEOUT, 2, data, markers)) {
+  const ZoneProfile &profile = zoneProfile(zone);
+  const unsigned long timeout = (unsigned long) profile.uplinkTime + profile.downlinkDelay;
+  if (!sendBuffer(message, timeout, 1, data, markers, true)) {
+    fccKnown = false;  //  Frames may have been sent anyway, so query the macro channel before the next send.
+    return false;
+  }
+  log1(data);
+  lastSend = millis();
+  downlinkStart = lastSend;
+  downlinkLine = "";
+  downlinkPending = true;
+  return true;
+}
+
+DownlinkStatus Wisol::pollResponse(String &response) {
+  //  Read the downlink chars buffered since the last poll, without waiting.  Returns
+  //  DOWNLINK_RECEIVED with the response message from SIGFOX when the "RX=" line is complete.
+  //  Returns DOWNLINK_FAILED if the module returns an error or the downlink window closes.
+  if (!downlinkPending) return DOWNLINK_NONE;
+  DownlinkStatus status = DOWNLINK_PENDING;
+  const ZoneProfile &profile = zoneProfile(zone);
+  //  Emulator returns an empty downlink when the downlink window opens.
+  if (useEmulator && millis() - downlinkStart >= profile.downlinkDelay) status = DOWNLINK_RECEIVED;
+  while (!useEmulator && status == DOWNLINK_PENDING && serialPort->available() > 0) {
+    const int rxChar = serialPort->read();
+    if (rxChar == -1) break;
+    if (rxChar == '\n') continue;
+    if (rxChar != END_OF_RESPONSE) { downlinkLine.concat((char) rxChar); continue; }
+    //  Line complete.  Response contains RX=01 23 45 67 89 AB CD EF
+    if (downlinkLine.indexOf("RX=") >= 0) status = DOWNLINK_RECEIVED;
+    else if (downlinkLine.length() > 0) status = DOWNLINK_FAILED;
+  }
+  if (status == DOWNLINK_PENDING && millis() - downlinkStart > downlinkTimeout(profile) + COMMAND_TIMEOUT)
+    status = DOWNLINK_FAILED;
+  if (status == DOWNLINK_PENDING) return status;
+
+  downlinkPending = false;
+  if (!useEmulator) serialPort->end();
+  logBuffer(F("<< "), downlinkLine.c_str(), 0, 0);
+  if (status == DOWNLINK_FAILED) {
+    log2(F(" - Wisol.pollResponse: Error: No downlink: "), downlinkLine);
+    return status;
+  }
+  //  Remove the prefix and spaces.
+  response = downlinkLine.substring(downlinkLine.indexOf("RX=") + 3);
+  response.replace(" ", "");
+  log2(F(" - Wisol.pollResponse: response: "), response);
+  return status;
+}
+
+bool Wisol::sendHeartbeat(bool bit) {
+  //  Send a bit frame with AT$SB= to tell SIGFOX cloud that we are alive.  The frame has no
+  //  payload bytes, so it takes about half the airtime and energy of a 12-byte message.
+  //  Counts as a message for the duty cycle.  Return true if successful.
+  log2(F(" - Wisol.sendHeartbeat: "), device + ',' + (bit ? '1' : '0'));
+  if (!isReady()) return false;  //  Prevent user from sending too many messages.
+  //  Exit command mode and prepare to send message.
+  if (!exitCommandMode()) return false;
+  //  Set the output power for the zone.
+  if (!setOutputPower()) return false;
+  //  Send the bit.
+  String message = String(CMD_SEND_BIT) + (bit ? '1' : '0') + CMD_END, data;
+  if (sendBuffer(message, WISOL_COMMAND_TIMEOUT, 1, data, markers)) {  //  One '\r' marker expected ("OK\r").
     log1(data);
     lastSend = millis();
-    response = data;
-    //  Response contains OK\nRX=01 23 45 67 89 AB CD EF
-    //  Remove the prefix and spaces.
-    response.replace("OK\nRX=", "");
-    response.replace(" ", "");
     return true;
   }
+  fccKnown = false;  //  Frames may have been sent anyway, so query the macro channel before the next send.
   return false;
 }
 
 bool Wisol::setOutputPower() {
-  //  Set the output power for the zone before sending a message.
-  switch(zone) {
-    case 1:  //  RCZ1
-    case 3:  //  RCZ3
-      if (!sendCommand(String(CMD_OUTPUT_POWER_MAX) + CMD_END, 1, data, markers)) return false;
-      break;
-    case 2:  //  RCZ2
-    case 4: {  //  RCZ4
-      if (!sendCommand(String(CMD_PRESEND) + CMD_END, 1, data, markers)) return false;
-      //  Parse the returned X,Y.
-      int x = data.charAt(0) - '0';
-      int y = data.charAt(2) - '0';
-      // log4("x,y=", String(x), ',', String(y));
-      if (x == 0 || y < 3) sendCommand(String(CMD_PRESEND2) + CMD_END, 1, data, markers);
-      break;
-    }
-    default:
-      log2(F(" - Wisol.setOutputPower: Unknown zone "), zone);
-      return false;
+  //  Set the output power for the zone before sending a message.  In zones with FCC
+  //  macro channels (RCZ2, RCZ4) the power is fixed, but the channel must be checked.
+  if (zone < 1 || zone > ZONE_COUNT) {
+    log2(F(" - Wisol.setOutputPower: Unknown zone "), zone);
+    return false;
+  }
+  const ZoneProfile &profile = zoneProfile(zone);
+  if (!profile.presend) {
+    const int zonePower = (power > profile.maxPower) ? profile.maxPower : power;
+    return sendCommand(String(CMD_OUTPUT_POWER) + zonePower + CMD_END, 1, data, markers);
   }
+  return checkMacroChannel();
+}
+
+bool Wisol::checkMacroChannel() {
+  //  Before sending in RCZ2 and RCZ4, reset the FCC macro channel with AT$RC if it has fewer
+  //  free micro-channels than frames to send.  The micro-channels free are predicted from the
+  //  sends since the last AT$GI? query, so AT$GI? is only sent at the start and every
+  //  FCC_VERIFY_SENDS sends.  Each send uses FCC_FRAMES_PER_SEND micro-channels, all free
+  //  again after FCC_DWELL_PERIOD.  The send that follows must clear fccKnown if it fails,
+  //  because the frames sent are then unknown.
+  const unsigned long now = millis();
+  if (fccKnown && now - fccLastSend >= FCC_DWELL_PERIOD) fccFree = fccChannels;
+  bool reset = false;
+  if (!fccKnown || fccSends >= FCC_VERIFY_SENDS) {
+    if (!sendCommand(String(CMD_PRESEND) + CMD_END, 1, data, markers)) return false;
+    if (useEmulator) data = "1,6";  //  Emulator has 6 micro-channels free.
+    fccQueries++;
+    //  Parse the returned X,Y.
+    int x = data.charAt(0) - '0';
+    int y = data.charAt(2) - '0';
+    // log4("x,y=", String(x), ',', String(y));
+    if (y < 0 || y > 9) y = 0;
+    if (y > fccChannels) fccChannels = y;
+    fccFree = y;
+    fccSends = 0;
+    fccKnown = true;
+    reset = (x == 0 || y < FCC_FRAMES_PER_SEND);
+  } else reset = (fccFree < FCC_FRAMES_PER_SEND);
+  if (reset) {
+    if (sendCommand(String(CMD_PRESEND2) + CMD_END, 1, data, markers)) fccResets++;
+    fccFree = fccChannels;
+    //  Query again if we haven't seen how many micro-channels are free after a reset.
+    if (fccChannels < FCC_FRAMES_PER_SEND) fccKnown = false;
+  }
+  //  The message is sent next.
+  fccFree = (fccFree > FCC_FRAMES_PER_SEND) ? fccFree - FCC_FRAMES_PER_SEND : 0;
+  fccLastSend = now;
+  fccSends++;
   return true;
 }
 
@@ -211,11 +403,12 @@ bool Wisol::exitCommandMode() {
 bool Wisol::getID(String &id, String &pac) {
   //  Get the SIGFOX ID and PAC for the module.
   if (useEmulator) { id = device; return true; }
-  if (!sendCommand(String(CMD_GET_ID) + CMD_END, 1, data, markers)) return false;
-  id = data;
+  const String commands[] = { CMD_GET_ID, CMD_GET_PAC };
+  String responses[2];
+  if (!sendCommands(commands, 2, responses)) return false;
+  id = responses[0];
   device = id;
-  if (!sendCommand(String(CMD_GET_PAC) + CMD_END, 1, data, markers)) return false;
-  pac = data;
+  pac = responses[1];
   log2(F(" - Wisol.getID: returned id="), id + ", pac=" + pac);
   return true;
 }
@@ -238,6 +431,52 @@ bool Wisol::getVoltage(float &voltage) {
   return true;
 }
 
+bool Wisol::getTelemetry(float &temperature, float &voltage, unsigned long maxAge) {
+  //  Returns the temperature and power supply voltage of the SIGFOX module.  Both commands are
+  //  pipelined in one session, so the port is opened once.  If the last reading is newer than
+  //  maxAge milliseconds, return it without talking to the module.
+  if (telemetryValid && millis() - telemetryTime < maxAge) {
+    temperature = telemetryTemperature;
+    voltage = telemetryVoltage;
+    return true;
+  }
+  if (useEmulator) {
+    telemetryTemperature = 36;
+    telemetryVoltage = 12.3;
+  } else {
+    const String commands[] = { CMD_GET_TEMPERATURE, CMD_GET_VOLTAGE };
+    String responses[2];
+    if (!sendCommands(commands, 2, responses)) return false;
+    telemetryTemperature = responses[0].toInt() / 100.0;
+    telemetryVoltage = responses[1].toFloat() / 1000.0;
+  }
+  telemetryTime = millis();
+  telemetryValid = true;
+  temperature = telemetryTemperature;
+  voltage = telemetryVoltage;
+  log4(F(" - Wisol.getTelemetry: returned "), temperature, F(", "), voltage);
+  return true;
+}
+
+bool Wisol::sendTelemetry() {
+  //  Send an out-of-band frame with AT$SO.  The module adds its own voltage and temperature,
+  //  so we don't need to read them first.  Counts as a message for the duty cycle.
+  log2(F(" - Wisol.sendTelemetry: "), device);
+  if (!isReady()) return false;  //  Prevent user from sending too many messages.
+  //  Exit command mode and prepare to send message.
+  if (!exitCommandMode()) return false;
+  //  Set the output power for the zone.
+  if (!setOutputPower()) return false;
+  String message = String(CMD_SEND_OUT_OF_BAND) + CMD_END, data;
+  if (sendBuffer(message, WISOL_COMMAND_TIMEOUT, 1, data, markers)) {  //  One '\r' marker expected ("OK\r").
+    log1(data);
+    lastSend = millis();
+    return true;
+  }
+  fccKnown = false;  //  Frames may have been sent anyway, so query the macro channel before the next send.
+  return false;
+}
+
 bool Wisol::getHardware(String &hardware) {
   //  TODO
   log1(F(" - Wisol.getHardware: ERROR - Not implemented"));
@@ -260,17 +499,36 @@ bool Wisol::getParameter(uint8_t address, String &value) {
   return true;
 }
 
-bool Wisol::getPower(int &power) {
-  //  Get the power step-down.
-  log1(F(" - Wisol.getPower: ERROR - Not implemented"));
-  power = 0;
+bool Wisol::getPower(int &power0) {
+  //  Get the output power in dBm.
+  if (useEmulator) { power0 = power; return true; }
+  if (!sendCommand(String(CMD_GET_OUTPUT_POWER) + CMD_END, 1, data, markers)) return false;
+  power0 = (int) data.toInt();
+  log2(F(" - Wisol.getPower: returned "), power0);
   return true;
 }
 
-bool Wisol::setPower(int power) {
-  //  TODO: Power value: 0...14
-  log1(F(" - Wisol.setPower: ERROR - Not implemented"));
-  return true;
+bool Wisol::setPower(int power0) {
+  //  Set the output power in dBm, from WISOL_MIN_POWER to WISOL_MAX_POWER.  Lower power uses
+  //  less energy per message but reaches fewer base stations.  For RCZ1 and RCZ3, the power is
+  //  set again before every send, up to the max power of the zone.  RCZ2 and RCZ4 modules
+  //  transmit at their fixed power.
+  const ZoneProfile &profile = zoneProfile(zone);
+  if (power0 < WISOL_MIN_POWER) power0 = WISOL_MIN_POWER;
+  if (power0 > WISOL_MAX_POWER) power0 = WISOL_MAX_POWER;
+  if (power0 > profile.maxPower) power0 = profile.maxPower;
+  power = power0;
+  log2(F(" - Wisol.setPower: "), power);
+  if (profile.presend) return true;
+  return sendCommand(String(CMD_OUTPUT_POWER) + power + CMD_END, 1, data, markers);
+}
+
+int Wisol::getMaxPower() {
+  //  Return the max output power in dBm that setPower() may set: the lower of the module
+  //  max and the zone max.  Returns -1 for RCZ2 and RCZ4, where the module fixes the power.
+  const ZoneProfile &profile = zoneProfile(zone);
+  if (profile.presend) return -1;
+  return (profile.maxPower < WISOL_MAX_POWER) ? profile.maxPower : WISOL_MAX_POWER;
 }
 
 bool Wisol::getEmulator(int &result) {
@@ -308,36 +566,24 @@ bool Wisol::getFrequency(String &result) {
 }
 
 bool Wisol::setFrequency(int zone0, String &result) {
-  //  Get the frequency used for the SIGFOX module
+  //  Set the uplink frequency for the zone and save it to the module flash.
   //  1: Europe (RCZ1)
   //  2: US (RCZ2)
   //  3: JP (RCZ3)
   //  4: AU/NZ (RCZ4)
+  //  The frequency is read first and written only if different, because the flash wears out.
+  if (zone0 < 1 || zone0 > ZONE_COUNT) {
+    log2(F(" - Wisol.setFrequency: Unknown zone "), zone0);
+    return false;
+  }
   zone = zone0;
-  switch(zone) {
-    case 1:  //  RCZ1
-      // if (!sendCommand(String(CMD_RCZ1) + CMD_END, 1, data, markers)) return false;
-      // if (!sendCommand(String(CMD_OUTPUT_POWER_MAX) + CMD_END, 1, data, markers)) return false;
-      // if (!sendCommand(String(CMD_MODULATION_ON) + CMD_END, 1, data, markers)) return false;
-      break;
-    case 2:  //  RCZ2
-      // if (!sendCommand(String(CMD_RCZ2) + CMD_END, 1, data, markers)) return false;
-      // if (!sendCommand(String(CMD_MODULATION_ON) + CMD_END, 1, data, markers)) return false;
-      break;
-    case 3:  //  RCZ3
-      // if (!sendCommand(String(CMD_RCZ3) + CMD_END, 1, data, markers)) return false;
-      // if (!sendCommand(String(CMD_OUTPUT_POWER_MAX) + CMD_END, 1, data, markers)) return false;
-      // if (!sendCommand(String(CMD_MODULATION_ON) + CMD_END, 1, data, markers)) return false;
-      break;
-    case 4:  //  RCZ4
-      // if (!sendCommand(String(CMD_RCZ4) + CMD_END, 1, data, markers)) return false;
-      // if (!sendCommand(String(CMD_MODULATION_ON) + CMD_END, 1, data, markers)) return false;
-      break;
-    default:
-      log2(F(" - Wisol.setFrequency: Unknown zone "), zone);
-      return false;
-  }
-  // if (!sendCommand(String(CMD_MODULATION_OFF) + CMD_END, 1, data, markers)) return false;
+  const String frequency = String(zoneProfile(zone).uplinkFrequency);
+  if (!sendCommand(String(CMD_GET_FREQUENCY) + CMD_END, 1, data, markers)) return false;
+  if (data != frequency) {
+    log2(F(" - Wisol.setFrequency: Writing frequency "), frequency);
+    if (!sendCommand(String(CMD_SET_FREQUENCY) + frequency + CMD_END, 1, data, markers)) return false;
+    if (!writeSettings(result)) return false;
+  }
   result = "OK";
   return true;
 }
@@ -375,8 +621,10 @@ bool Wisol::reboot(String &result) {
 }
 
 bool Wisol::writeSettings(String &result) {
-  //  TODO: Write settings to module's flash memory.
-  log1(F(" - Wisol.writeSettings: ERROR - Not implemented"));
+  //  Write settings to module's flash memory, so they are kept after power off.
+  log1(F(" - Wisol.writeSettings"));
+  if (!sendCommand(String(CMD_WRITE_SETTINGS) + CMD_END, 1, data, markers)) return false;
+  result = data;
   return true;
 }
 
@@ -397,7 +645,7 @@ Wisol::Wisol(Country country0, bool useEmulator0, const String device0, bool ech
                          uint8_t rx, uint8_t tx) {
   //  Init the module with the specified transmit and receive pins.
   //  Default to no echo.
-  zone = 4;  //  RCZ4
+  zone = zoneOf(country0);
   country = country0;
   useEmulator = useEmulator0;
   device = device0;
@@ -441,21 +689,15 @@ bool Wisol::begin() {
     echoPort->print(F(" - SIGFOX ID = "));  Serial.println(id);
     echoPort->print(F(" - PAC = "));  Serial.println(pac);
 
-    //  Set the frequency of SIGFOX module.
-    // log1(F(" - Setting frequency for country "));
-    // echoPort->write((uint8_t) (country / 8));
-    // echoPort->write((uint8_t) (country % 8));
-    if (country == COUNTRY_JP) {  //  Set Japan frequency (RCZ3).
-      if (!setFrequencyJP(result)) continue;
-    } else if (country == COUNTRY_US) {  //  Set US frequency (RCZ2).
-      if (!setFrequencyUS(result)) continue;
-    } else if (
-      country == COUNTRY_FR
-      || country == COUNTRY_OM
-      || country == COUNTRY_SA) {  //  Set France frequency (RCZ1).
-      if (!setFrequencyETSI(result)) continue;
-    } else { //  Rest of the world runs on RCZ4.
-      if (!setFrequencySG(result)) continue;
+    //  Set the frequency of SIGFOX module for the zone of the country.
+    const int countryZone = zoneOf(country);
+    if (!useEmulator && Storage::isZoneSaved(countryZone, id)) {
+      //  Zone was set on an earlier boot.  Skip the frequency commands.
+      zone = countryZone;
+      result = "Saved";
+    } else {
+      if (!setFrequency(countryZone, result)) continue;
+      if (!useEmulator) Storage::saveZone(countryZone, id);
     }
     log2(F(" - Set frequency result = "), result);
 
@@ -25,8 +25,25 @@
 
 const uint8_t WISOL_TX = 4;  //  Transmit port for For UnaBiz / Wisol Dev Kit
 const uint8_t WISOL_RX = 5;  //  Receive port for UnaBiz / Wisol Dev Kit
+const int WISOL_MIN_POWER = 0;  //  Min output power in dBm.
+const int WISOL_MAX_POWER = 15;  //  Max output power in dBm, used by default.
 const unsigned int WISOL_COMMAND_TIMEOUT = 60000;  //  Wait up to 60 seconds for response from SIGFOX module.  Includes downlink response.
 
+//  In RCZ2 and RCZ4, each frame hops to a micro-channel of the FCC macro channel, and a
+//  micro-channel may be used again only after the FCC dwell period.  AT$GI? returns X,Y:
+//  X=0 if the macro channel must be reset, Y the micro-channels free.  We model Y to skip the query.
+const uint8_t FCC_FRAMES_PER_SEND = 3;  //  Each message is sent as 3 frames, each on a different micro-channel.
+const unsigned long FCC_DWELL_PERIOD = 20000;  //  Micro-channels used are free again after 20 seconds.
+const uint8_t FCC_VERIFY_SENDS = 16;  //  Query AT$GI? after this many predicted sends, to correct the model.
+
+//  State of a downlink response started by startMessageAndGetResponse().
+enum DownlinkStatus {
+  DOWNLINK_NONE,  //  No downlink requested.
+  DOWNLINK_PENDING,  //  Uplink sent, waiting for the downlink window.
+  DOWNLINK_RECEIVED,  //  Downlink received.
+  DOWNLINK_FAILED,  //  Module returned an error or the downlink window closed.
+};
+
 class Wisol
 {
 public:
@@ -41,7 +58,10 @@ public:
   bool isReady();
   bool sendMessage(const String &payload);  //  Send the payload of hex digits to the network, max 12 bytes.
   bool sendMessageAndGetResponse(const String &payload, String &response);  //  Send the payload of hex digits to the network and get response.
+  bool startMessageAndGetResponse(const String &payload);  //  Send the payload and return after the uplink, without waiting for the downlink.
+  DownlinkStatus pollResponse(String &response);  //  Collect the downlink without blocking.  Call often until not DOWNLINK_PENDING.
   bool sendString(const String &str);  //  Sending a text string, max 12 characters allowed.
+  bool sendHeartbeat(bool bit = true);  //  Send a bit frame, the shortest frame, to show that we are alive.
   bool receive(String &data);  //  Receive a message.
   bool enterCommandMode();  //  Enter Command Mode for sending module commands, not data.
   bool exitCommandMode();  //  Exit Command Mode so we can send data.
@@ -67,11 +87,20 @@ public:
   bool getTemperature(float &temperature);
   bool getID(String &id, String &pac);  //  Get the SIGFOX ID and PAC for the module.
   bool getVoltage(float &voltage);
+  bool getTelemetry(float &temperature, float &voltage, unsigned long maxAge = TELEMETRY_MAX_AGE);  //  Read temperature and voltage together, or reuse the last reading.
+  bool sendTelemetry();  //  Send an out-of-band frame, with the voltage and temperature added by the module.
   bool getHardware(String &hardware);
   bool getFirmware(String &firmware);
-  bool getPower(int &power);
-  bool setPower(int power);
+  bool getPower(int &power);  //  Get the output power in dBm.
+  bool setPower(int power);  //  Set the output power in dBm for RCZ1 and RCZ3.
+  int getMaxPower();  //  Return the max output power in dBm that setPower() may set, or -1 if the module fixes the power.
   bool getParameter(uint8_t address, String &value);  //  Return the parameter at that address.
+  bool sendCommands(const String commands[], uint8_t count, String responses[]);  //  Pipeline independent read-only commands.  Responses in the same order.
+  uint16_t getLateResponses();  //  Return the number of responses that arrived after their command timed out.
+  uint16_t getStrayBytes();  //  Return the number of bytes received that were not a response to any command.
+  void classifyLateResponse(String late);  //  Count the bytes drained before a command as a late response or stray bytes.
+  uint16_t getChannelQueries();  //  For RCZ2, 4: Return the number of AT$GI? queries of the FCC macro channel.
+  uint16_t getChannelResets();  //  For RCZ2, 4: Return the number of AT$RC resets of the FCC macro channel.
 
   //  Message conversion functions.
   String toHex(int i);
@@ -86,8 +115,8 @@ public:
 private:
   bool sendCommand(const String &cmd, uint8_t expectedMarkers,
                    String &result, uint8_t &actualMarkers);
-  bool sendBuffer(const String &buffer, int timeout, uint8_t expectedMarkers,
-                  String &dataOut, uint8_t &actualMarkers);
+  bool sendBuffer(const String &buffer, unsigned long timeout, uint8_t expectedMarkers,
+                  String &dataOut, uint8_t &actualMarkers, bool keepOpen = false);  //  keepOpen to keep receiving after the markers.
   bool setFrequency(int zone, String &result);
   uint8_t hexDigitToDecimal(char ch);
   void logBuffer(const __FlashStringHelper *prefix, const char *buffer,
@@ -101,7 +130,28 @@ private:
   Print *echoPort;  //  Port for sending echo output.  Defaults to Serial.
   Print *lastEchoPort;  //  Last port used for sending echo output.
   unsigned long lastSend;  //  Timestamp of last send.
+  int power = WISOL_MAX_POWER;  //  Output power in dBm for RCZ1 and RCZ3.
+  unsigned long telemetryTime = 0;  //  Timestamp of the last telemetry reading.
+  bool telemetryValid = false;  //  True after the first telemetry reading.
+  float telemetryTemperature = 0;  //  Module temperature at the last telemetry reading.
+  float telemetryVoltage = 0;  //  Module voltage at the last telemetry reading.
   bool setOutputPower();
+  void openPort();  //  Start the serial port for a session.
+  void drainLateResponse();  //  Read and classify the bytes received since the port was started, before sending.
+  String lastCommand;  //  Last command sent, for attributing a late response.
+  uint16_t lateResponses = 0;  //  Number of responses received after their command timed out.
+  uint16_t strayBytes = 0;  //  Number of bytes received that were not a response.
+  bool checkMacroChannel();  //  For RCZ2, 4: Reset the macro channel if too few micro-channels are free.
+  bool fccKnown = false;  //  True if the macro channel state has been queried with AT$GI?.
+  uint8_t fccFree = 0;  //  Micro-channels predicted free now.
+  uint8_t fccChannels = 0;  //  Micro-channels free after a reset or the dwell period, the max seen by AT$GI?.
+  uint8_t fccSends = 0;  //  Sends predicted since the last AT$GI? query.
+  unsigned long fccLastSend = 0;  //  Timestamp of the last send in RCZ2, 4.
+  uint16_t fccQueries = 0;  //  Number of AT$GI? queries.
+  uint16_t fccResets = 0;  //  Number of AT$RC resets.
+  bool downlinkPending = false;  //  True while the serial port is kept open for the downlink.
+  unsigned long downlinkStart = 0;  //  Timestamp of the uplink that requested the downlink.
+  String downlinkLine;  //  Chars of the downlink line received so far.
 };
 
 #endif // UNABIZ_ARDUINO_WISOL_H
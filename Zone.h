@@ -0,0 +1,77 @@
+//  SIGFOX radio configuration zones (RCZ) and the zone used in each country.  The drivers look up
+//  the zone profile here instead of testing the country and zone themselves, so that all drivers
+//  agree on the zone and the lookup may be done at compile time when the country is a constant.
+#ifndef UNABIZ_ARDUINO_ZONE_H
+#define UNABIZ_ARDUINO_ZONE_H
+
+#ifdef ARDUINO
+  #if (ARDUINO >= 100)
+    #include <Arduino.h>
+  #else  //  ARDUINO >= 100
+    #include <WProgram.h>
+  #endif  //  ARDUINO  >= 100
+#endif  //  ARDUINO
+
+const uint8_t ZONE_COUNT = 4;  //  RCZ1 to RCZ4.
+const uint8_t DEFAULT_ZONE = 4;  //  Countries not in the table use RCZ4.
+
+//  Regulatory and timing rules of a zone.
+struct ZoneProfile {
+  uint8_t zone;  //  1 to 4 for RCZ1 to RCZ4.
+  unsigned long uplinkFrequency;  //  Uplink centre frequency in Hz.
+  unsigned long downlinkFrequency;  //  Downlink centre frequency in Hz.
+  int8_t maxPower;  //  Max output power in dBm allowed in the zone.
+  bool presend;  //  True if the FCC macro channel must be checked before sending.  Power is then fixed by the module.
+  uint8_t dutyCycle;  //  Max transmit time in tenths of a percent, or 0 if not limited by duty cycle.
+  unsigned int uplinkTime;  //  Milliseconds to transmit the 3 frames of a 12-byte message.
+  unsigned int downlinkDelay;  //  Milliseconds after the uplink before the downlink window opens.
+  unsigned int downlinkWindow;  //  Milliseconds that the downlink window stays open.
+};
+
+//  Indexed by zone - 1.
+constexpr ZoneProfile zoneProfiles[ZONE_COUNT] = {
+  //  zone, uplink and downlink Hz, dBm, presend, duty, uplink time, downlink delay and window.
+  { 1, 868130000UL, 869525000UL, 14, false, 10, 6000, 20000, 25000 },  //  RCZ1: Europe, Oman, South Africa.
+  { 2, 902200000UL, 905200000UL, 22, true,   0, 1000, 20000, 25000 },  //  RCZ2: USA.
+  { 3, 923200000UL, 922200000UL, 16, false,  0, 6000, 20000, 25000 },  //  RCZ3: Japan.  Listen before talk.
+  { 4, 920800000UL, 922300000UL, 22, true,   0, 1000, 20000, 25000 },  //  RCZ4: Singapore, Taiwan, Australia, New Zealand.
+};
+
+//  Zone of each country that doesn't use DEFAULT_ZONE.
+struct CountryZone {
+  Country country;
+  uint8_t zone;
+};
+
+constexpr CountryZone countryZones[] = {
+  { COUNTRY_FR, 1 },
+  { COUNTRY_OM, 1 },
+  { COUNTRY_SA, 1 },
+  { COUNTRY_US, 2 },
+  { COUNTRY_JP, 3 },
+};
+
+constexpr uint8_t countryZoneCount = sizeof(countryZones) / sizeof(countryZones[0]);
+
+constexpr uint8_t zoneOf(Country country, uint8_t index = 0) {
+  //  Return the zone 1 to 4 used in the country.
+  return (index >= countryZoneCount) ? DEFAULT_ZONE :
+    (countryZones[index].country == country) ? countryZones[index].zone : zoneOf(country, index + 1);
+}
+
+constexpr const ZoneProfile &zoneProfile(uint8_t zone) {
+  //  Return the profile of the zone 1 to 4.  Unknown zones get the profile of DEFAULT_ZONE.
+  return zoneProfiles[(zone >= 1 && zone <= ZONE_COUNT) ? zone - 1 : DEFAULT_ZONE - 1];
+}
+
+constexpr const ZoneProfile &countryProfile(Country country) {
+  //  Return the profile of the zone used in the country.
+  return zoneProfile(zoneOf(country));
+}
+
+constexpr unsigned long downlinkTimeout(const ZoneProfile &profile) {
+  //  Return the milliseconds to wait for a downlink after starting the uplink.
+  return (unsigned long) profile.uplinkTime + profile.downlinkDelay + profile.downlinkWindow;
+}
+
+#endif  //  UNABIZ_ARDUINO_ZONE_H
@@ -9,6 +9,7 @@ static const bool useEmulator = false;  //  Set to true if using UnaBiz Emulator
 static const bool echo = true;  //  Set to true if the SIGFOX library should display the executed commands.
 static const Country country = COUNTRY_JP;  //  Set this to your country to configure the SIGFOX transmission frequencies.
 static UnaShieldV2S transceiver(country, useEmulator, device, echo);  //  Uncomment this for UnaBiz UnaShield V2S Dev Kit
+static Message msg(transceiver);  //  Will contain the structured sensor data.  Reused in every loop, so its storage is allocated only once.
 static String response;  //  Will store the downlink response from SIGFOX.
 
 void setup() {  //  Will be called only once.
@@ -30,13 +31,12 @@ void loop() {  //  Will be called repeatedly.
   static int counter = 0, successCount = 0, failCount = 0;  //  Count messages sent and failed.
   Serial.print(F("\nRunning loop #")); Serial.println(counter);
 
-  //  Get temperature and voltage of the SIGFOX module.
+  //  Get temperature and voltage of the SIGFOX module, read together and reused for 10 minutes.
   float temperature;  float voltage;
-  transceiver.getTemperature(temperature);
-  transceiver.getVoltage(voltage);
+  transceiver.getTelemetry(temperature, voltage);
 
   //  Convert the numeric counter, temperature and voltage into a compact message with binary fields.
-  Message msg(transceiver);  //  Will contain the structured sensor data.
+  msg.reset();  //  Clear the fields of the previous message.
   msg.addField("ctr", counter);  //  4 bytes for the counter.
   msg.addField("tmp", temperature);  //  4 bytes for the temperature.
   msg.addField("vlt", voltage);  //  4 bytes for the voltage.
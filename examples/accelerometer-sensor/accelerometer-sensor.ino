@@ -1,99 +1,85 @@
-/**************************************************************************/
-/*!
-    @file     Adafruit_MMA8451.h
-    @author   K. Townsend (Adafruit Industries)
-    @license  BSD (see license.txt)
-
-    This is an example for the Adafruit MMA8451 Accel breakout board
-    ----> https://www.adafruit.com/products/2019
-
-    Adafruit invests time and resources providing this open source code,
-    please support Adafruit and open-source hardware by purchasing
-    products from Adafruit!
-
-    @section  HISTORY
-
-    v1.0  - First release
-*/
-/**************************************************************************/
+//  Send motion, tilt and shock events from the MMA8451 accelerometer as SIGFOX messages
+//  with UnaBiz UnaShield V2S Arduino Shield.  The accelerometer is sampled every 100 milliseconds
+//  and the samples are checked on the Arduino by MotionDetector, so that we send a message only
+//  when the device starts or stops moving, is tipped over or is hit.  For asset tracking.
+//
+//  Based on the Adafruit MMA8451 example: https://github.com/adafruit/Adafruit_MMA8451_Library
+//  Adafruit invests time and resources providing this open source code,
+//  please support Adafruit and open-source hardware by purchasing
+//  products from Adafruit!
+
+////////////////////////////////////////////////////////////
+//  Begin Sensor Declaration
+//  Don't use ports D0, D1: Reserved for viewing debug output through Arduino Serial Monitor
+//  Don't use ports D4, D5: Reserved for serial comms with the SIGFOX module.
 
 #include <Wire.h>
 #include <Adafruit_MMA8451.h>
 #include <Adafruit_Sensor.h>
 
 Adafruit_MMA8451 mma = Adafruit_MMA8451();
+static const unsigned long SAMPLE_DELAY = 100;  //  Sample the accelerometer every 100 milliseconds.
 
-void setup(void) {
-  Serial.begin(9600);
-  
-  Serial.println("Adafruit MMA8451 test!");
-  
+//  End Sensor Declaration
+////////////////////////////////////////////////////////////
 
-  ////if (! mma.begin()) {
-  if (! mma.begin(0x1c)) { ////  //  NOTE: Must use 0x1c for UnaShield V2S
-    Serial.println("Couldnt start");
-    while (1);
-  }
-  Serial.println("MMA8451 found!");
-  
-  mma.setRange(MMA8451_RANGE_2_G);
-  
-  Serial.print("Range = "); Serial.print(2 << mma.getRange());  
-  Serial.println("G");
-  
+////////////////////////////////////////////////////////////
+//  Begin SIGFOX Module Declaration
+
+#include "SIGFOX.h"
+
+//  IMPORTANT: Check these settings with UnaBiz to use the SIGFOX library correctly.
+static const String device = "g88pi";  //  Set this to your device name if you're using UnaBiz Emulator.
+static const bool useEmulator = false;  //  Set to true if using UnaBiz Emulator.
+static const bool echo = true;  //  Set to true if the SIGFOX library should display the executed commands.
+static const Country country = COUNTRY_SG;  //  Set this to your country to configure the SIGFOX transmission frequencies.
+static UnaShieldV2S transceiver(country, useEmulator, device, echo);  //  Accelerometer is only on UnaBiz UnaShield V2S Dev Kit.
+static Message msg(transceiver);  //  Will contain the events.  Reused for every send, so its storage is allocated only once.
+static MotionDetector detector(COUNTS_PER_G_8G);  //  Raw reading for 1 g in the 8G range, so that shocks are not clipped.
+
+//  End SIGFOX Module Declaration
+////////////////////////////////////////////////////////////
+
+static unsigned long lastSend = 0;  //  Time of the last send, to comply with the duty cycle.
+static bool sent = false;  //  True after the first send.
+
+void setup() {  //  Will be called only once.
+  //  Initialize console so we can see debug messages (9600 bits per second).
+  Serial.begin(9600);  Serial.println(F("Running setup..."));
+
+  //  Check whether the accelerometer is functioning.
+  if (!mma.begin(0x1c)) stop("Unable to init accelerometer");  //  NOTE: Must use 0x1c for UnaShield V2S.
+  mma.setRange(MMA8451_RANGE_8_G);
+
+  //  Check whether the SIGFOX module is functioning.
+  if (!transceiver.begin()) stop("Unable to init SIGFOX module, may be missing");  //  Will never return.
+
+  //  Echo the events in one line when sending.
+  msg.setEchoMode(ECHO_SUMMARY);
 }
 
-void loop() {
-  // Read the 'raw' data in 14-bit counts
+void loop() {  //  Will be called repeatedly.
+  //  Read the raw data in 14-bit counts and check for events.
   mma.read();
-  Serial.print("X:\t"); Serial.print(mma.x); 
-  Serial.print("\tY:\t"); Serial.print(mma.y); 
-  Serial.print("\tZ:\t"); Serial.print(mma.z); 
-  Serial.println();
-
-  /* Get a new sensor event */ 
-  sensors_event_t event; 
-  mma.getEvent(&event);
-
-  /* Display the results (acceleration is measured in m/s^2) */
-  Serial.print("X: \t"); Serial.print(event.acceleration.x); Serial.print("\t");
-  Serial.print("Y: \t"); Serial.print(event.acceleration.y); Serial.print("\t");
-  Serial.print("Z: \t"); Serial.print(event.acceleration.z); Serial.print("\t");
-  Serial.println("m/s^2 ");
-  
-  /* Get the orientation of the sensor */
-  uint8_t o = mma.getOrientation();
-  
-  switch (o) {
-    case MMA8451_PL_PUF: 
-      Serial.println("Portrait Up Front");
-      break;
-    case MMA8451_PL_PUB: 
-      Serial.println("Portrait Up Back");
-      break;    
-    case MMA8451_PL_PDF: 
-      Serial.println("Portrait Down Front");
-      break;
-    case MMA8451_PL_PDB: 
-      Serial.println("Portrait Down Back");
-      break;
-    case MMA8451_PL_LRF: 
-      Serial.println("Landscape Right Front");
-      break;
-    case MMA8451_PL_LRB: 
-      Serial.println("Landscape Right Back");
-      break;
-    case MMA8451_PL_LLF: 
-      Serial.println("Landscape Left Front");
-      break;
-    case MMA8451_PL_LLB: 
-      Serial.println("Landscape Left Back");
-      break;
-    }
-  Serial.println();
-  delay(500);
-  
+  uint8_t events = detector.update(mma.x, mma.y, mma.z);
+  if (events & MOTION_EVENT) Serial.println(F("Moving"));
+  if (events & STILL_EVENT) Serial.println(F("Stopped"));
+  if (events & TILT_EVENT) Serial.println(F("Tilted"));
+  if (events & SHOCK_EVENT) { Serial.print(F("Shock ")); Serial.print(detector.getPeakMilliG()); Serial.println(F(" milli-g")); }
+
+  //  Send the events since the last send, if any.  Events that happen within
+  //  the 10-minute duty cycle are combined into the next message.
+  if (detector.getEvents() != 0 && (!sent || millis() - lastSend >= SEND_DELAY)) {
+    msg.reset();
+    detector.addFields(msg);
+    if (msg.send()) detector.clearEvents();  //  If the send failed, keep the events and retry later.
+    lastSend = millis();
+    sent = true;
+  }
+  delay(SAMPLE_DELAY);
 }
+
+//  Raw samples from the original Adafruit example.  1 g reads as about 4096 counts in the 2G range.
 /*
 Adafruit MMA8451 test!
 MMA8451 found!
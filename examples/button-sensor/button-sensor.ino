@@ -1,83 +1,56 @@
-/*
-  Button
-
- Turns on and off a light emitting diode(LED) connected to digital
- pin 13, when pressing a pushbutton attached to pin 2.
-
-
- The circuit:
- * LED attached from pin 13 to ground
- * pushbutton attached to pin 2 from +5V
- * 10K resistor attached to pin 2 from ground
-
- * Note: on most Arduinos there is already an LED on the board
- attached to pin 13.
-
-
- created 2005
- by DojoDave <http://www.0j0.org>
- modified 30 Aug 2011
- by Tom Igoe
-
- This example code is in the public domain.
-
- http://www.arduino.cc/en/Tutorial/Button
- */
-
-// constants won't change. They're used here to
-// set pin numbers:
-const int buttonPin = 6;     // the number of the pushbutton pin
-const int ledPin =  13;      // the number of the LED pin
-
-// variables will change:
-int buttonState = 0;         // variable for reading the pushbutton status
-
-void setup() {
-  Serial.begin(9600);
-
-  // initialize the LED pin as an output:
-  pinMode(ledPin, OUTPUT);
-  // initialize the pushbutton pin as an input:
-  pinMode(buttonPin, INPUT);
+//  Send a SIGFOX message immediately when an alarm button is pressed, with UnaBiz UnaShield Arduino Shield.
+//  Instead of polling the button in a loop, the button wakes up the Arduino through an interrupt.
+//  The Arduino sleeps between the periodic sends, and sends within seconds when the button is
+//  pressed, as long as the duty cycle allows.  The number of presses is also sent periodically.
+//
+//  Connect the pushbutton between port D2 and GND.  The internal pull-up resistor is used,
+//  so no external resistor is needed.  D2 is used because it supports interrupts.
+
+////////////////////////////////////////////////////////////
+//  Begin Sensor Declaration
+//  Don't use ports D0, D1: Reserved for viewing debug output through Arduino Serial Monitor
+//  Don't use ports D4, D5: Reserved for serial comms with the SIGFOX module.
+
+const int buttonPin = 2;  //  The number of the pushbutton pin.  Must support interrupts.
+
+//  End Sensor Declaration
+////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////
+//  Begin SIGFOX Module Declaration
+
+#include "SIGFOX.h"
+
+//  IMPORTANT: Check these settings with UnaBiz to use the SIGFOX library correctly.
+static const String device = "g88pi";  //  Set this to your device name if you're using UnaBiz Emulator.
+static const bool useEmulator = false;  //  Set to true if using UnaBiz Emulator.
+static const bool echo = true;  //  Set to true if the SIGFOX library should display the executed commands.
+static const Country country = COUNTRY_SG;  //  Set this to your country to configure the SIGFOX transmission frequencies.
+static UnaShieldV2S transceiver(country, useEmulator, device, echo);  //  Uncomment this for UnaBiz UnaShield V2S Dev Kit
+// static UnaShieldV1 transceiver(country, useEmulator, device, echo);  //  Uncomment this for UnaBiz UnaShield V1 Dev Kit
+static Message msg(transceiver);  //  Will contain the button presses.
+static Scheduler scheduler(msg);  //  Will send the message periodically, or when the button is pressed.
+static WakeupPin button(buttonPin);  //  Will wake up the Arduino when the button is pressed.
+
+//  End SIGFOX Module Declaration
+////////////////////////////////////////////////////////////
+
+void setup() {  //  Will be called only once.
+  //  Initialize console so we can see debug messages (9600 bits per second).
+  Serial.begin(9600);  Serial.println(F("Running setup..."));
+
+  //  Check whether the SIGFOX module is functioning.
+  if (!transceiver.begin()) stop("Unable to init SIGFOX module, may be missing");  //  Will never return.
+
+  //  Count the button presses and send them when pressed.
+  int buttonField = scheduler.addField("btn", AGGREGATE_SUM);
+  button.setScheduler(scheduler, buttonField);
+  if (!button.begin()) stop("Button pin doesn't support interrupts");  //  Will never return.
 }
 
-void loop() {
-  // read the state of the pushbutton value:
-  buttonState = digitalRead(buttonPin);
-
-  // check if the pushbutton is pressed.
-  // if it is, the buttonState is HIGH:
-  if (buttonState == HIGH) {
-    // turn LED on:    
-    digitalWrite(ledPin, HIGH);
-    Serial.println("Not pushed");
-  } else {
-    // turn LED off:
-    digitalWrite(ledPin, LOW);
-    Serial.println("Pushed");
-  }
+void loop() {  //  Will be called repeatedly.
+  //  Pass the button presses to the scheduler, which sends if pressed or if the send interval is due.
+  if (button.poll() > 0) Serial.println(F("Pushed"));
+  //  Sleep until the next send is due, or until the button is pressed.
+  button.sleep(scheduler.run());
 }
-/*
-Not pushed
-Not pushed
-Not pushed
-Not pushed
-Not pushed
-Pushed
-Pushed
-Pushed
-Pushed
-Pushed
-Pushed
-Pushed
-Pushed
-Pushed
-Not pushed
-Not pushed
-Not pushed
-Not pushed
-Not pushed
-Not pushed
-Not pushed
-
- */
@@ -0,0 +1,95 @@
+//  Sample multiple sensors at different rates and send the aggregated samples as SIGFOX messages
+//  with UnaBiz UnaShield Arduino Shield.  Instead of a delay() loop for each sensor, the Scheduler
+//  calls each sensor's sample function at its own rate and sends the message when the send interval
+//  has elapsed.  Timers that fall close together are run together to reduce the CPU wake-ups.
+//
+//  This code assumes that you are using the Grove Light Sensor v1.1 on port A0
+//  and a pushbutton on port D6, as in examples/send-light-level and examples/button-sensor.
+
+////////////////////////////////////////////////////////////
+//  Begin Sensor Declaration
+//  Don't use ports D0, D1: Reserved for viewing debug output through Arduino Serial Monitor
+//  Don't use ports D4, D5: Reserved for serial comms with the SIGFOX module.
+
+#ifdef BEAN_BEAN_BEAN_H
+  #define LIGHT_SENSOR A2  //  For Bean+, Grove Light Sensor is connected to port A2.
+#else
+  #define LIGHT_SENSOR A0  //  Else Grove Light Sensor is connected to port A0.
+#endif //  BEAN_BEAN_BEAN_H
+
+const int buttonPin = 6;  //  The number of the pushbutton pin.
+
+//  End Sensor Declaration
+////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////
+//  Begin SIGFOX Module Declaration
+
+#include "SIGFOX.h"
+
+//  IMPORTANT: Check these settings with UnaBiz to use the SIGFOX library correctly.
+static const String device = "g88pi";  //  Set this to your device name if you're using UnaBiz Emulator.
+static const bool useEmulator = false;  //  Set to true if using UnaBiz Emulator.
+static const bool echo = true;  //  Set to true if the SIGFOX library should display the executed commands.
+static const Country country = COUNTRY_SG;  //  Set this to your country to configure the SIGFOX transmission frequencies.
+static UnaShieldV2S transceiver(country, useEmulator, device, echo);  //  Uncomment this for UnaBiz UnaShield V2S Dev Kit
+// static UnaShieldV1 transceiver(country, useEmulator, device, echo);  //  Uncomment this for UnaBiz UnaShield V1 Dev Kit
+static Message msg(transceiver);  //  Will contain the aggregated sensor data.
+static Scheduler scheduler(msg);  //  Will sample the sensors and send the message.
+
+//  End SIGFOX Module Declaration
+////////////////////////////////////////////////////////////
+
+//  Field indexes returned by scheduler.addField().
+static int lightField, tempField, buttonField;
+
+void sampleLight(Scheduler &s) {
+  //  Read the light sensor from the analog port.  Sent as the average light level.
+  s.record(lightField, analogRead(LIGHT_SENSOR));
+}
+
+void sampleTemperature(Scheduler &s) {
+  //  Read the temperature of the SIGFOX module.  Sent as the max temperature.
+  float temperature;
+  if (transceiver.getTemperature(temperature)) s.record(tempField, temperature);
+}
+
+void sampleButton(Scheduler &s) {
+  //  Count the button presses.  Pressed when the pin is LOW.
+  static int lastState = HIGH;
+  int state = digitalRead(buttonPin);
+  if (state == LOW && lastState == HIGH) s.record(buttonField, 1);
+  lastState = state;
+}
+
+void setup() {  //  Will be called only once.
+  //  Initialize console so we can see debug messages (9600 bits per second).
+  Serial.begin(9600);  Serial.println(F("Running setup..."));
+  pinMode(buttonPin, INPUT);
+
+  //  Check whether the SIGFOX module is functioning.
+  if (!transceiver.begin()) stop("Unable to init SIGFOX module, may be missing");  //  Will never return.
+
+  //  Echo the fields in one line when sending.
+  msg.setEchoMode(ECHO_SUMMARY);
+
+  //  Fields to be sent.  Max 3 fields.
+  lightField = scheduler.addField("lig", AGGREGATE_AVERAGE);
+  tempField = scheduler.addField("tmp", AGGREGATE_MAX);
+  buttonField = scheduler.addField("btn", AGGREGATE_SUM);
+
+  //  Sample each sensor at its own rate, in milliseconds.
+  scheduler.addSensor(50, sampleButton);  //  Every 50 milliseconds.
+  scheduler.addSensor(10 * 1000, sampleLight);  //  Every 10 seconds.
+  scheduler.addSensor(60 * 1000, sampleTemperature);  //  Every minute.
+
+  //  Send every 10 minutes.
+  scheduler.setSendInterval(SEND_DELAY);
+}
+
+void loop() {  //  Will be called repeatedly.
+  //  Sample the sensors that are due and send the message when due.
+  //  Then wait until the next sensor is due.
+  unsigned long wait = scheduler.run();
+  delay(wait);
+}
@@ -34,6 +34,7 @@ static const bool echo = true;  //  Set to true if the SIGFOX library should dis
 static const Country country = COUNTRY_SG;  //  Set this to your country to configure the SIGFOX transmission frequencies.
 // static UnaShieldV2S transceiver(country, useEmulator, device, echo);  //  Uncomment this for UnaBiz UnaShield V2S Dev Kit
 static UnaShieldV1 transceiver(country, useEmulator, device, echo);  //  Uncomment this for UnaBiz UnaShield V1 Dev Kit
+static Message msg(transceiver);  //  Will contain the structured sensor data.  Reused in every loop, so its storage is allocated only once.
 
 //  End SIGFOX Module Declaration
 ////////////////////////////////////////////////////////////
@@ -88,7 +89,7 @@ void loop() {  //  Will be called repeatedly.
   int temperature;  transceiver.getTemperature(temperature);
 
   //  Convert the numeric counter, light level and temperature into a compact message with binary fields.
-  Message msg(transceiver);  //  Will contain the structured sensor data.
+  msg.reset();  //  Clear the fields of the previous message.
   msg.addField("ctr", counter);  //  4 bytes for the counter.
   msg.addField("lig", light_level);  //  4 bytes for the light level.
   msg.addField("tmp", temperature);  //  4 bytes for the temperature.
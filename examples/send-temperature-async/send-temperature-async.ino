@@ -0,0 +1,71 @@
+//  Send the temperature and humidity from a DHT sensor to the SIGFOX cloud, without blocking.
+//  Like examples/send-temperature, but the sensor is read by DHTReader instead of the DHT library.
+//  The DHT library disables interrupts for about 5 milliseconds while reading, which may corrupt
+//  the responses from the SIGFOX module.  DHTReader times the sensor pulses with an interrupt,
+//  so the SIGFOX module and the sensor may be used together.
+//
+//  This code assumes that you are using the Grove DHT Sensor Pro:
+//  http://wiki.seeedstudio.com/wiki/Grove_-_Temperature_and_Humidity_Sensor_Pro
+//  Connect the sensor to Port D2 of Grove - Base Shield.  D2 is used because it supports interrupts.
+
+////////////////////////////////////////////////////////////
+//  Begin Sensor Declaration
+//  Don't use ports D0, D1: Reserved for viewing debug output through Arduino Serial Monitor
+//  Don't use ports D4, D5: Reserved for serial comms with the SIGFOX module.
+
+#define DHTPIN 2  //  What pin we're connected to. 2 means Port D2.  Must support interrupts.
+#define DHTTYPE 11  //  11 for DHT11, 22 for DHT22 (AM2302), 21 for DHT21 (AM2301).
+
+//  End Sensor Declaration
+////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////
+//  Begin SIGFOX Module Declaration
+
+#include "SIGFOX.h"
+
+//  IMPORTANT: Check these settings with UnaBiz to use the SIGFOX library correctly.
+static const String device = "g88pi";  //  Set this to your device name if you're using UnaBiz Emulator.
+static const bool useEmulator = false;  //  Set to true if using UnaBiz Emulator.
+static const bool echo = true;  //  Set to true if the SIGFOX library should display the executed commands.
+static const Country country = COUNTRY_SG;  //  Set this to your country to configure the SIGFOX transmission frequencies.
+// static UnaShieldV2S transceiver(country, useEmulator, device, echo);  //  Uncomment this for UnaBiz UnaShield V2S Dev Kit
+static UnaShieldV1 transceiver(country, useEmulator, device, echo);  //  Uncomment this for UnaBiz UnaShield V1 Dev Kit
+static Message msg(transceiver);  //  Will contain the aggregated sensor data.
+static Scheduler scheduler(msg);  //  Will start the sensor readings and send the message.
+static DHTReader dht(DHTPIN, DHTTYPE);  //  Will read the sensor without blocking.
+
+//  End SIGFOX Module Declaration
+////////////////////////////////////////////////////////////
+
+void sampleTemperature(Scheduler &s) {
+  //  Start reading the sensor.  The reading is recorded in the scheduler by dht.poll() when done.
+  if (!dht.start()) Serial.println(F("Sensor busy"));
+}
+
+void setup() {  //  Will be called only once.
+  //  Initialize console so we can see debug messages (9600 bits per second).
+  Serial.begin(9600);  Serial.println(F("Running setup..."));
+
+  //  Check whether the sensor pin and the SIGFOX module are functioning.
+  if (!dht.begin()) stop("Sensor pin doesn't support interrupts");  //  Will never return.
+  if (!transceiver.begin()) stop("Unable to init SIGFOX module, may be missing");  //  Will never return.
+
+  //  Send the average temperature and humidity every 10 minutes.
+  int tempField = scheduler.addField("tmp", AGGREGATE_AVERAGE);
+  int humidityField = scheduler.addField("hmd", AGGREGATE_AVERAGE);
+  dht.setScheduler(scheduler, tempField, humidityField);
+  scheduler.addSensor(30 * 1000, sampleTemperature);  //  Read every 30 seconds.
+  scheduler.setSendInterval(SEND_DELAY);
+}
+
+void loop() {  //  Will be called repeatedly.
+  //  Run the scheduler and continue any sensor reading, then wait until either needs us again.
+  unsigned long wait = scheduler.run();
+  unsigned long dhtWait = dht.poll();
+  if (dht.isReady()) {
+    Serial.print(F("Temperature: ")); Serial.println(dht.readTemperature());
+    Serial.print(F("Humidity: ")); Serial.println(dht.readHumidity());
+  }
+  delay(min(wait, dhtWait));
+}
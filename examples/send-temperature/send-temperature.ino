@@ -37,6 +37,7 @@ static const bool echo = true;  //  Set to true if the SIGFOX library should dis
 static const Country country = COUNTRY_SG;  //  Set this to your country to configure the SIGFOX transmission frequencies.
 // static UnaShieldV2S transceiver(country, useEmulator, device, echo);  //  Uncomment this for UnaBiz UnaShield V2S Dev Kit
 static UnaShieldV1 transceiver(country, useEmulator, device, echo);  //  Uncomment this for UnaBiz UnaShield V1 Dev Kit
+static Message msg(transceiver);  //  Will contain the structured sensor data.  Reused in every loop, so its storage is allocated only once.
 
 //  End SIGFOX Module Declaration
 ////////////////////////////////////////////////////////////
@@ -117,7 +118,7 @@ void loop()
   // Sensor readings may also be up to 2 seconds 'old' (its a very slow sensor)
   float tmp = dht.readTemperature();
   float hmd = dht.readHumidity();
-  Message msg(transceiver);  //  Will contain the structured sensor data.
+  msg.reset();  //  Clear the fields of the previous message.
 
   // Check if returns are valid, if they are NaN (not a number) then something went wrong!
   if (isnan(tmp) || isnan(hmd)) {
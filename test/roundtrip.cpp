@@ -0,0 +1,197 @@
+//  Randomized round-trip test for the Message codec under Windows or Mac without Arduino.
+//  Encodes random field combinations, checks that decodeMessage(getEncodedMessage())
+//  returns the expected fields, and reports the encode/decode throughput.
+//  Usage: roundtrip [iterations] [seed]
+#ifndef ARDUINO
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <ctype.h>
+#include "util.cpp"
+#include "sigfox.cpp"
+
+static const int maxFields = MAX_BYTES_PER_MESSAGE / 4;  //  4 bytes per field: 3 fields per message.
+static const int maxValue = 3276;  //  Largest int that fits in 16 bits after scaling by 10.
+
+//  Name letters to pick from.  5 to 9 and symbols can only be encoded with NAME_6BIT.
+//  '!' can't be encoded at all.  Letters that can't be encoded end the name.
+static const char nameLetters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-.+%/#*!";
+static const char letters5[] = "abcdefghijklmnopqrstuvwxyz01234";
+static const char letters6[] = "abcdefghijklmnopqrstuvwxyz0123456789_-.+%/#*";
+
+static uint32_t randomState = 1;
+
+static uint32_t nextRandom() {
+  //  Xorshift generator, so that the results are the same on every platform.
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static int randomInt(int min, int max) {
+  //  Return a random int from min to max inclusive.
+  return min + (int) (nextRandom() % (uint32_t) (max - min + 1));
+}
+
+struct Field {
+  char name[4];  //  Name as passed to addField().
+  bool isFloat;  //  True if added as a float, else as an int.
+  int intValue;
+  int tenths;  //  floatValue in tenths, as generated.
+  float floatValue;
+};
+
+static void randomField(Field &field) {
+  //  Generate a random field with a name of 0 to 3 letters.
+  int len = randomInt(0, 3);
+  for (int i = 0; i < 4; i++)
+    field.name[i] = (i < len) ? nameLetters[randomInt(0, sizeof(nameLetters) - 2)] : 0;
+  field.isFloat = randomInt(0, 1) == 1;
+  field.intValue = randomInt(-maxValue, maxValue);
+  field.tenths = randomInt(-maxValue * 10, maxValue * 10);
+  field.floatValue = field.tenths / 10.0f;
+}
+
+static bool isExtended(const Field &field, NameEncoding encoding) {
+  //  Return true if we expect the name to be encoded in 6 bits.
+  if (encoding != NAME_6BIT) return false;
+  for (int i = 0; i < 3 && field.name[i]; i++) {
+    char ch = tolower(field.name[i]);
+    if (!strchr(letters5, ch)) return strchr(letters6, ch) != 0;
+  }
+  return false;
+}
+
+static void expectField(const Field &field, NameEncoding encoding, char *buf, size_t size) {
+  //  Write the field as we expect decodeMessage() to return it.
+  //  The name is lowercase and ends at the first letter that can't be encoded.
+  const char *letters = isExtended(field, encoding) ? letters6 : letters5;
+  char name[4] = {0, 0, 0, 0};
+  for (int i = 0; i < 3 && field.name[i]; i++) {
+    char ch = tolower(field.name[i]);
+    if (!strchr(letters, ch)) break;
+    name[i] = ch;
+  }
+  int value = field.isFloat ? field.tenths : field.intValue * 10;
+  int absValue = value < 0 ? -value : value;
+  snprintf(buf, size, "\"%s\":%s%d.%d", name, value < 0 ? "-" : "", absValue / 10, absValue % 10);
+}
+
+static bool addField(Message &msg, const Field &field) {
+  if (field.isFloat) return msg.addField(field.name, field.floatValue);
+  return msg.addField(field.name, field.intValue);
+}
+
+int main(int argc, char **argv) {
+  const long iterations = (argc > 1) ? atol(argv[1]) : 1000000;
+  randomState = (argc > 2) ? (uint32_t) atol(argv[2]) : 20170613;
+  if (randomState == 0) randomState = 1;
+  printf("roundtrip: iterations=%ld, seed=%lu\n", iterations, (unsigned long) randomState);
+
+  //  Don't echo the commands, we only want the encoding.
+  static Radiocrafts transceiver(COUNTRY_SG, false, "g88pi", false);
+  static Message reusedMsg(transceiver);
+
+  long failures = 0, fields = 0;
+  double encodeTime = 0, decodeTime = 0;
+  Field msgFields[maxFields + 1];
+  char expected[256], buf[64];
+
+  //  Float fields with known encodings: name "tmp" is b051, then the value in tenths, LSB first.
+  //  -3276.8 is the smallest 16-bit value, which must decode without overflow.
+  static const struct { float value; const char *encoded, *decoded; } floats[] = {
+    {23.4f, "b051ea00", "{\"tmp\":23.4}"},
+    {579.3f, "b051a116", "{\"tmp\":579.3}"},
+    {0.7f, "b0510700", "{\"tmp\":0.7}"},
+    {-0.7f, "b051f9ff", "{\"tmp\":-0.7}"},
+    {-3276.8f, "b0510080", "{\"tmp\":-3276.8}"},
+  };
+  for (unsigned f = 0; f < sizeof(floats) / sizeof(floats[0]); f++) {
+    Message msg(transceiver);
+    msg.addField("tmp", floats[f].value);
+    String encodedMsg = msg.getEncodedMessage();
+    String decodedMsg = Message::decodeMessage(encodedMsg);
+    if (encodedMsg != floats[f].encoded || decodedMsg != floats[f].decoded) {
+      printf("FAIL float field: encoded=%s expected=%s\n  decoded=%s expected=%s\n", encodedMsg.c_str(),
+             floats[f].encoded, decodedMsg.c_str(), floats[f].decoded);
+      failures++;
+    }
+  }
+
+  //  A string field after a 6-bit name: the value takes 2 bytes, so the next field stays aligned.
+  {
+    Message msg(transceiver);
+    msg.setNameEncoding(NAME_6BIT);
+    bool added = msg.addField("pm5", "x9") && msg.addField("tmp", 23.4);
+    String encodedMsg = msg.getEncodedMessage();
+    String decodedMsg = Message::decodeMessage(encodedMsg);
+    const char *tail = "\"tmp\":23.4}";
+    const size_t len = strlen(decodedMsg.c_str());
+    if (!added || encodedMsg.length() != 18 || len < strlen(tail)
+        || strcmp(decodedMsg.c_str() + len - strlen(tail), tail) != 0) {
+      printf("FAIL string field: encoded=%s\n  decoded=%s\n", encodedMsg.c_str(), decodedMsg.c_str());
+      failures++;
+    }
+  }
+
+  for (long i = 0; i < iterations; i++) {
+    //  Alternate between random lengths and max-length messages.
+    //  Add 1 more field to check that full messages refuse it.
+    const int count = (i % 2 == 0) ? randomInt(1, maxFields) : maxFields + 1;
+    const NameEncoding encoding = (i % 4 < 2) ? NAME_5BIT : NAME_6BIT;
+    for (int f = 0; f < count; f++) randomField(msgFields[f]);
+
+    //  Encode.  Alternate between a new message and a reused message.
+    clock_t start = clock();
+    Message newMsg(transceiver);
+    Message &msg = (i % 8 < 4) ? newMsg : reusedMsg;
+    msg.reset();
+    msg.setNameEncoding(encoding);
+    bool added[maxFields + 1];
+    for (int f = 0; f < count; f++) added[f] = addField(msg, msgFields[f]);
+    String encodedMsg = msg.getEncodedMessage();
+    encodeTime += clock() - start;
+
+    //  Decode.
+    start = clock();
+    String decodedMsg = Message::decodeMessage(encodedMsg);
+    decodeTime += clock() - start;
+
+    //  Fields are accepted only if they fit into the message.
+    strcpy(expected, "{");
+    bool ok = true;
+    unsigned length = 0;
+    for (int f = 0; f < count; f++) {
+      unsigned fieldLength = isExtended(msgFields[f], encoding) ? 5 : 4;
+      bool fits = length + fieldLength <= MAX_BYTES_PER_MESSAGE;
+      if (added[f] != fits) ok = false;
+      if (!fits) continue;
+      length += fieldLength;
+      fields++;
+      if (strlen(expected) > 1) strcat(expected, ",");
+      expectField(msgFields[f], encoding, buf, sizeof(buf));
+      strcat(expected, buf);
+    }
+    strcat(expected, "}");
+
+    if (!ok || encodedMsg.length() != length * 2
+        || strcmp(decodedMsg.c_str(), expected) != 0) {
+      if (failures < 10) {
+        printf("FAIL #%ld: encoded=%s\n  decoded=%s\n  expected=%s\n", i,
+               encodedMsg.c_str(), decodedMsg.c_str(), expected);
+      }
+      failures++;
+    }
+  }
+  const double encodeSecs = encodeTime / CLOCKS_PER_SEC, decodeSecs = decodeTime / CLOCKS_PER_SEC;
+  printf("encode: %ld messages, %ld fields in %.3f s, %.0f messages/s\n",
+         iterations, fields, encodeSecs, encodeSecs > 0 ? iterations / encodeSecs : 0);
+  printf("decode: %ld messages, %ld fields in %.3f s, %.0f messages/s\n",
+         iterations, fields, decodeSecs, decodeSecs > 0 ? iterations / decodeSecs : 0);
+  printf("roundtrip: %ld failures\n", failures);
+  return failures == 0 ? 0 : 1;
+}
+#endif  //  ARDUINO
@@ -0,0 +1,20 @@
+//  Include the SIGFOX library sources into a single translation unit for testing under Windows or Mac.
+//  Must be included after util.cpp.
+#ifndef ARDUINO
+#include "../Radiocrafts.cpp"
+#include "../Akeru.cpp"
+//  Wisol.cpp is built separately by wisol.cpp.
+#include "../Message.cpp"
+#include "../Scheduler.cpp"
+#include "../MotionDetector.cpp"
+#include "../WakeupPin.cpp"
+#include "../DHTReader.cpp"
+#include "../AnomalyDetector.cpp"
+#include "../BatteryPolicy.cpp"
+#include "../DownlinkPolicy.cpp"
+#include "../SyncClock.cpp"
+#include "../Storage.cpp"
+#include "../SampleLog.cpp"
+#include "../LossEstimator.cpp"
+#include "../PowerControl.cpp"
+#endif  //  ARDUINO
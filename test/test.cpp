@@ -6,9 +6,12 @@
 #include <unistd.h>
 #include <time.h>
 #include "util.cpp"
-#include "../Radiocrafts.cpp"
-#include "../Akeru.cpp"
-#include "../Message.cpp"
+#include "sigfox.cpp"
+
+static int failures = 0;  //  Number of checks failed.
+
+//  Report a failed check.  The test fails if any check fails.
+#define check(condition) { if (!(condition)) { printf("FAIL line %d: %s\n", __LINE__, #condition); failures++; } }
 
 int main() {
   puts("test");
@@ -27,7 +30,432 @@ int main() {
   printf("encodedMsg=%s\n", encodedMsg.c_str());
   String decodedMsg = Message::decodeMessage(encodedMsg);
   printf("decodedMsg=%s\n", decodedMsg.c_str());
-  msg.send();
+  check(decodedMsg == "{\"ctr\":123.0,\"tmp\":30.1,\"hmd\":98.7}");
+  check(msg.send());
+
+  //  Same message with the chainable API, echoed in one line when sending.
+  Message msg2(transceiver);
+  msg2.setEchoMode(ECHO_SUMMARY);
+  msg2.add("ctr", 123).add("tmp", 30.1).add("hmd", 98.7);
+  printf("chained encodedMsg=%s\n", msg2.getEncodedMessage().c_str());
+  check(msg2.getEncodedMessage() == encodedMsg);
+  msg2.send();
+
+  //  Detect events from simulated accelerometer samples in the 8G range, like the
+  //  accelerometer-sensor example: still, shaken, dropped, then tipped over.
+  MotionDetector detector(COUNTS_PER_G_8G);
+  uint8_t allEvents = 0;
+  for (int i = 0; i < 100; i++) {
+    int x = 0, y = 0, z = COUNTS_PER_G_8G;
+    if (i >= 20 && i < 40) x = (i % 2) ? 200 : -200;  //  Shaken.
+    if (i == 50) z = COUNTS_PER_G_8G * 3;  //  Dropped, 3 g is within the 8G range.
+    if (i >= 60) { y = COUNTS_PER_G_8G; z = 0; }  //  Tipped over.
+    uint8_t events = detector.update(x, y, z);
+    allEvents |= events;
+    if (i == 50) check(events & SHOCK_EVENT);
+    if (events) printf("sample %d: events=%d moving=%d orientation=%d\n",
+                       i, events, detector.isMoving(), detector.getOrientation());
+  }
+  Message msg3(transceiver);
+  detector.addFields(msg3);
+  printf("motion decodedMsg=%s\n", Message::decodeMessage(msg3.getEncodedMessage()).c_str());
+  check(allEvents == (MOTION_EVENT | STILL_EVENT | TILT_EVENT | SHOCK_EVENT));
+  check(detector.getOrientation() == ORIENTATION_Y_UP);
+
+  //  Button presses request a send without waiting for the send interval.
+  Message msg4(transceiver);
+  msg4.setEchoMode(ECHO_SUMMARY);
+  Scheduler scheduler(msg4);
+  WakeupPin button(2);
+  button.setScheduler(scheduler, scheduler.addField("btn", AGGREGATE_SUM));
+  button.begin();
+  WakeupPin::handleInterrupt();  //  Simulate a button press.
+  const int presses = button.poll();
+  printf("button presses=%d\n", presses);
+  check(presses == 1);
+  delay(3000);  //  Wait for the transceiver to allow the next send.
+  unsigned long wait = scheduler.run();
+  printf("button wait=%lu sent=%d\n", wait, scheduler.lastSendOK());
+  check(scheduler.lastSendOK());
+
+  //  Alert when the temperature jumps from its usual range.
+  Message msg5(transceiver);
+  msg5.setEchoMode(ECHO_SUMMARY);
+  AnomalyDetector anomaly(msg5);
+  int tmpField = anomaly.addField("tmp", 3.0, 0.2);
+  int anomalies = 0;
+  for (int i = 0; i < 40; i++) {
+    float tmp = 4.0 + (i % 3) * 0.1 + (i == 30 ? 5.0 : 0);  //  Cold room, door opened at sample 30.
+    const bool abnormal = anomaly.update(tmpField, tmp);
+    check(abnormal == (i == 30));
+    if (abnormal) anomalies++;
+    if (abnormal)
+      printf("sample %d: anomaly tmp=%.1f mean=%.2f deviation=%.2f z=%.1f\n", i, tmp,
+             anomaly.getMean(tmpField), anomaly.getDeviation(tmpField), anomaly.getZScore(tmpField));
+  }
+  delay(3000);  //  Wait for the transceiver to allow the next send.
+  check(anomalies == 1);
+  check(anomaly.sendAlert());
+  check(!anomaly.isAlertPending());
+
+  //  Battery draining 20 millivolts per hour.  The trend fitted to the averages of 6 samples is
+  //  -480 mV per day, so the 220 mV left last 11 hours.  Level 36% stretches the interval 2 times,
+  //  and empty within a week stretches it 2 times more.
+  Message msgBattery(transceiver);
+  Scheduler batteryScheduler(msgBattery);
+  batteryScheduler.setSendInterval(SEND_DELAY);
+  BatteryPolicy battery(transceiver);
+  battery.begin(batteryScheduler);
+  for (int i = 0; i < 10; i++) battery.record(3400 - i * 20, i * 60UL * 60 * 1000);
+  printf("battery level=%d%% slope=%ldmV/day stretch=%d hoursLeft=%ld\n",
+         battery.getLevel(), battery.getSlope(), battery.getStretch(), battery.getHoursLeft());
+  check(battery.getLevel() == 36);
+  check(battery.getSlope() == -480);
+  check(battery.getHoursLeft() == 11);
+  check(battery.getStretch() == 4);
+  check(batteryScheduler.getSendInterval() == 4 * SEND_DELAY);
+  //  A noisy sample doesn't change the trend much, because the trend is fitted to all samples.
+  battery.record(3240, 10 * 60UL * 60 * 1000);
+  check(battery.getSlope() < -300 && battery.getSlope() > -480);
+  //  Same drain with millis() wrapping after the 4th sample.
+  BatteryPolicy wrappedBattery(transceiver);
+  for (int i = 0; i < 10; i++) wrappedBattery.record(3400 - i * 20, 0xFFFFFFFFUL - 3 * 60UL * 60 * 1000 + i * 60UL * 60 * 1000);
+  printf("battery wrapped slope=%ldmV/day hoursLeft=%ld\n", wrappedBattery.getSlope(), wrappedBattery.getHoursLeft());
+  check(wrappedBattery.getSlope() == -480 && wrappedBattery.getHoursLeft() == 11);
+
+  //  Request a downlink only for the first message, then send without waiting.
+  DownlinkPolicy downlinkPolicy;
+  downlinkPolicy.setBatteryPolicy(battery);
+  const bool downlinkRequested = downlinkPolicy.shouldRequest();
+  printf("downlink request=%d remaining=%d\n", downlinkRequested, downlinkPolicy.getRemaining());
+  check(downlinkRequested);
+  check(downlinkPolicy.getRemaining() == 4);
+
+  //  Sync the clock from a downlink, sleep 2 hours by the watchdog, then sync again 7 seconds later than expected.
+  SyncClock syncClock;
+  syncClock.handleDownlink("0159400000000000");  //  1497366528 = 13 Jun 2017.
+  syncClock.addSleep(2UL * 60 * 60 * 1000);
+  syncClock.sync(1497366528UL + 2 * 60 * 60 + 7);
+  printf("clock now=%lu sleep drift=%ldppm corrected 1h=%lums\n",
+         syncClock.now(), syncClock.getSleepDrift(), syncClock.correctSleep(60UL * 60 * 1000));
+  check(syncClock.isSynced());
+  check(syncClock.now() - (1497366528UL + 2 * 60 * 60 + 7) <= 1);
+  check(syncClock.getSleepDrift() > 950 && syncClock.getSleepDrift() < 1000);  //  7 s in 2 hours is 972 ppm.
+  check(syncClock.getDrift() == 0);  //  Sleep is not counted as millis() time.
+  //  Sleep another 2 hours with the same watchdog drift.  The sleep is now corrected, so the
+  //  clock is on time before the sync, and the sync doesn't change the drift of millis().
+  syncClock.addSleep(2UL * 60 * 60 * 1000);
+  const unsigned long expectedTime = 1497366528UL + 4 * 60 * 60 + 14;
+  printf("clock before sync now=%lu expected=%lu\n", syncClock.now(), expectedTime);
+  check(syncClock.now() - expectedTime <= 1 || expectedTime - syncClock.now() <= 1);
+  syncClock.sync(expectedTime);
+  check(syncClock.getSleepDrift() > 950 && syncClock.getSleepDrift() < 1000);
+  check(syncClock.getDrift() == 0);
+
+  //  Decode DHT22 pulse timings: 65.2 % and -10.1 degrees, then a bad checksum and a short pulse train.
+  DHTReader dht(2, 22);
+  const uint8_t dhtBytes[5] = {0x02, 0x8c, 0x80, 0x65, 0x73};
+  uint8_t dhtPulses[DHT_PULSES] = {80, 160};
+  for (int i = 0; i < 40; i++) dhtPulses[2 + i] = (dhtBytes[i / 8] & (0x80 >> (i % 8))) ? 120 : 76;
+  check(dht.decode(dhtPulses, DHT_PULSES));
+  printf("dht temperature=%.1f humidity=%.1f\n", dht.readTemperature(), dht.readHumidity());
+  check(dht.readTemperature() > -10.15 && dht.readTemperature() < -10.05);
+  check(dht.readHumidity() > 65.15 && dht.readHumidity() < 65.25);
+  dhtPulses[DHT_PULSES - 1] = 76;  //  Clear the last checksum bit.
+  check(!dht.decode(dhtPulses, DHT_PULSES));
+  dhtPulses[DHT_PULSES - 1] = 120;
+  check(!dht.decode(dhtPulses, 30));  //  Sensor stopped answering.
+  check(dht.readTemperature() > -10.15 && dht.readTemperature() < -10.05);  //  Last reading is kept.
+
+  //  Log temperature and humidity samples during an outage, then check the newest block and backfill.
+  SampleLog sampleLog;
+  sampleLog.begin(2);
+  sampleLog.setNames(Message::nameCode("tmp"), Message::nameCode("hmd"));
+  float logged[1000][2];
+  for (int i = 0; i < 1000; i++) {
+    logged[i][0] = 25.0 + ((i * 7) % 13) / 10.0 - (i == 500 ? 20 : 0);
+    logged[i][1] = 60.0 + ((i * 3) % 11) / 10.0;
+    sampleLog.append(logged[i]);
+  }
+  //  Every sample still in the log should decode to the value logged.
+  int blockSamples[LOG_BLOCK_SIZE * 2][MAX_LOG_FIELDS];
+  int stored = 0, mismatches = 0;
+  for (uint8_t b = 0; b < LOG_BLOCKS; b++) {
+    uint16_t first = 0;
+    uint8_t n = sampleLog.readBlock(b, blockSamples, LOG_BLOCK_SIZE * 2, &first);
+    for (uint8_t i = 0; i < n; i++, stored++)
+      for (uint8_t f = 0; f < 2; f++)
+        if (blockSamples[i][f] != (int) (logged[first + i][f] * 10 + 0.5)) mismatches++;
+  }
+  SampleLog reloaded;  //  Same as after a reset.
+  reloaded.begin(2);
+  printf("samplelog stored=%d mismatches=%d\n", stored, mismatches);
+  printf("samplelog next=%u reloaded=%u pending=%u blocks=%d\n", sampleLog.getSampleNumber(),
+         reloaded.getSampleNumber(), sampleLog.getPendingCount(), LOG_BLOCKS);
+  check(stored > 0 && mismatches == 0);
+  check(sampleLog.getSampleNumber() == 1000 && reloaded.getSampleNumber() == 1000);
+  check(sampleLog.getPendingCount() == stored);
+  Message msg6(transceiver);
+  const bool backfilled = sampleLog.addBackfill(msg6);
+  const String backfill = Message::decodeMessage(msg6.getEncodedMessage());
+  printf("samplelog backfill=%s\n", backfill.c_str());
+  check(backfilled && backfill.indexOf("\"tmp\"") >= 0 && backfill.indexOf("\"hmd\"") >= 0);
+
+  //  Number the frames sent.  The number is saved in EEPROM, so a reset doesn't restart it.
+  Message msg7(transceiver);
+  msg7.setSequence(true);
+  msg7.setRepetitions(2);
+  msg7.addField("tmp", 25.6);
+  const uint16_t sequence = Message::getSequence();
+  delay(3000);  //  Wait for the transceiver to allow the next send.
+  const bool sequenceSent = msg7.send();
+  printf("sequence before=%u sent=%d after=%u repeats=%d\n", sequence, sequenceSent,
+         Message::getSequence(), msg7.getRepeatsPending());
+  check(sequenceSent);
+  check(Message::getSequence() == (sequence + 1) % SEQUENCE_WRAP);
+  check(msg7.getRepeatsPending() == 1);
+
+  //  With sequencing on, the space for "seq" is reserved, so a full message fails when adding the fields.
+  Message msg8(transceiver);
+  msg8.setEchoMode(ECHO_NONE);
+  msg8.setSequence(true);
+  const bool firstFits = msg8.addField("tmp", 25.6) && msg8.addField("hmd", 50.0);
+  const bool thirdFits = msg8.addField("alt", 12.3);
+  const uint16_t fullSequence = Message::getSequence();
+  delay(3000);
+  const bool fullSent = msg8.send();
+  printf("sequence full message sent=%d third=%d\n", fullSent, thirdFits);
+  check(firstFits && !thirdFits && msg8.getCapacity() == 0);
+  check(fullSent && Message::getSequence() == (fullSequence + 1) % SEQUENCE_WRAP);
+  Message msg9(transceiver);
+  msg9.setEchoMode(ECHO_NONE);
+  msg9.addField("tmp", 25.6); msg9.addField("hmd", 50.0); msg9.addField("alt", 12.3);
+  check(!msg9.setSequence(true));
+  Scheduler sequenced(msg8);
+  check(sequenced.addField("tmp", AGGREGATE_LAST) == 0 && sequenced.addField("hmd", AGGREGATE_LAST) == 1);
+  check(sequenced.addField("alt", AGGREGATE_LAST) == -1);
+
+  //  Estimate the loss on the server from frames numbered across the wrap, with every 7th frame lost,
+  //  every 10th frame repeated and every 50th frame arriving late.
+  LossEstimator estimator;
+  for (int i = 0; i < 600; i++) {
+    const uint16_t seq = (SEQUENCE_WRAP - 100 + i) % SEQUENCE_WRAP;
+    const unsigned long sent = 1000000 + i * SEND_DELAY;
+    if (i % 7 == 3) continue;
+    if (i % 50 == 20) continue;
+    estimator.record(seq, sent + 2000, sent);
+    if (i % 10 == 0) estimator.record(seq, sent + 300000, sent);
+    if (i % 50 == 21) estimator.record((seq + SEQUENCE_WRAP - 1) % SEQUENCE_WRAP, sent + 60000, sent - SEND_DELAY);
+  }
+  const uint8_t repetitions = estimator.getRepetitions(0.01);
+  printf("loss received=%lu lost=%lu duplicates=%lu rate=%.3f latency=%lums\n", estimator.getReceived(),
+         estimator.getLost(), estimator.getDuplicates(), estimator.getLossRate(), estimator.getLatency());
+  printf("loss repetitions=%d interval=%lus for 1 sample per hour\n", repetitions,
+         estimator.getSendInterval(60UL * 60 * 1000, repetitions) / 1000);
+  check(estimator.getLossRate() > 0.10 && estimator.getLossRate() < 0.20);  //  1/7 + 1/50 lost.
+  check(estimator.getDuplicates() > 0);
+  check(repetitions == 3);
+  check(estimator.getSendInterval(60UL * 60 * 1000, repetitions) < 60UL * 60 * 1000);
+
+  //  Heartbeat with the shortest frame instead of a message with a counter.
+  delay(3000);  //  Wait for the transceiver to allow the next send.
+  const bool heartbeatSent = transceiver.sendHeartbeat();
+  printf("heartbeat sent=%d\n", heartbeatSent);
+  check(heartbeatSent);
+
+  //  Module telemetry is read once, then reused until it's older than TELEMETRY_MAX_AGE.
+  Radiocrafts emulatedTransceiver(country, true, device, echo);
+  float moduleTemperature = 0, moduleVoltage = 0;
+  const bool telemetryRead = emulatedTransceiver.getTelemetry(moduleTemperature, moduleVoltage);
+  const bool telemetryCached = emulatedTransceiver.getTelemetry(moduleTemperature, moduleVoltage);
+  printf("telemetry read=%d cached=%d temperature=%.1f voltage=%.2f\n", telemetryRead, telemetryCached,
+         moduleTemperature, moduleVoltage);
+  check(telemetryRead && telemetryCached);
+  check(moduleTemperature == 36 && moduleVoltage > 12.29 && moduleVoltage < 12.31);
+
+  //  Step the Wisol power down while the server reports low loss, and up after the loss above.
+  //  The power starts at the max of RCZ1.  In RCZ4 the module fixes the power.
+  Wisol wisolEurope(COUNTRY_FR, true, device, echo);
+  PowerControl powerControl(wisolEurope);
+  const bool powerStarted = powerControl.begin();
+  const int startPower = powerControl.getPower();
+  for (int i = 0; i < 9; i++) powerControl.reportLoss(0);
+  const int lowPower = powerControl.getPower();
+  powerControl.handleDownlink(estimator.getFeedback());
+  int modulePower = 0;  wisolEurope.getPower(modulePower);
+  printf("power start=%d low=%d feedback=%s after=%d module=%d\n", startPower, lowPower,
+         estimator.getFeedback().c_str(), powerControl.getPower(), modulePower);
+  check(powerStarted && startPower == countryProfile(COUNTRY_FR).maxPower);
+  check(lowPower == startPower - 3);
+  check(powerControl.getPower() > lowPower && powerControl.getPower() == modulePower);
+  Wisol wisol(country, true, device, echo);
+  PowerControl fixedPower(wisol);
+  check(!fixedPower.begin() && !fixedPower.reportLoss(50));
+
+  //  begin() writes the zone to the module once.  Later boots find it saved and skip the config
+  //  commands, unless the zone or the module has changed.
+  Storage::saveZone(4, "1AE8E2");
+  printf("zone saved=%d other zone=%d other module=%d\n", Storage::isZoneSaved(4, "1AE8E2"),
+         Storage::isZoneSaved(1, "1AE8E2"), Storage::isZoneSaved(4, "1AE8E3"));
+  check(Storage::isZoneSaved(4, "1AE8E2"));
+  check(!Storage::isZoneSaved(1, "1AE8E2") && !Storage::isZoneSaved(4, "1AE8E3"));
+
+  //  Radiocrafts config is read in one session and cached.  Only the changed bytes are written.
+  const bool configRead = emulatedTransceiver.readConfig();
+  emulatedTransceiver.setConfig(CONFIG_NETWORK_MODE, 0);  //  Same as cached, nothing to write.
+  emulatedTransceiver.setConfig(CONFIG_RF_POWER, 0x0e);
+  const bool configWritten = emulatedTransceiver.writeConfig();
+  uint8_t rfPower = 0;  uint8_t zone = 0;
+  emulatedTransceiver.getConfig(CONFIG_RF_POWER, rfPower);
+  emulatedTransceiver.getRCZ(zone);
+  printf("config read=%d written=%d power=0x%02x zone=%d\n", configRead, configWritten, rfPower, zone);
+  check(configRead && configWritten);
+  check(rfPower == 0x0e && zone == 1);
+
+  //  The zone of each country is looked up at compile time.  All drivers use the same table.
+  constexpr uint8_t omanZone = zoneOf(COUNTRY_OM);
+  constexpr unsigned long usTimeout = downlinkTimeout(countryProfile(COUNTRY_US));
+  printf("zone SG=%d OM=%d US=%d JP=%d presend=%d maxPower=%d downlink timeout=%lums\n", zoneOf(COUNTRY_SG),
+         omanZone, zoneOf(COUNTRY_US), zoneOf(COUNTRY_JP), countryProfile(COUNTRY_US).presend,
+         countryProfile(COUNTRY_FR).maxPower, usTimeout);
+  static_assert(zoneOf(COUNTRY_OM) == 1 && zoneOf(COUNTRY_SA) == 1, "Oman and South Africa use RCZ1");
+  check(zoneOf(COUNTRY_SG) == 4 && omanZone == 1 && zoneOf(COUNTRY_US) == 2 && zoneOf(COUNTRY_JP) == 3);
+  check(countryProfile(COUNTRY_US).presend && !countryProfile(COUNTRY_FR).presend);
+  check(usTimeout == 46000);
+  //  Wisol::setFrequency() saves the uplink frequency to the module flash, so it must be the regulatory one.
+  static_assert(zoneProfile(1).uplinkFrequency == 868130000UL && zoneProfile(2).uplinkFrequency == 902200000UL
+                && zoneProfile(3).uplinkFrequency == 923200000UL && zoneProfile(4).uplinkFrequency == 920800000UL,
+                "Uplink frequencies of RCZ1 to RCZ4");
+
+  //  Wisol returns after the uplink.  Sample the sensors while waiting for the downlink window.
+  String downlink;  int samplesDuringWait = 0;
+  delay(3000);  //  Wait for the transceiver to allow the next send.
+  const bool downlinkStarted = wisol.startMessageAndGetResponse("0102030405060708090a0b0c");
+  DownlinkStatus downlinkStatus = DOWNLINK_PENDING;
+  while (downlinkStarted && (downlinkStatus = wisol.pollResponse(downlink)) == DOWNLINK_PENDING)
+    samplesDuringWait++;
+  printf("downlink started=%d status=%d samples=%d\n", downlinkStarted, downlinkStatus, samplesDuringWait);
+  check(downlinkStarted && downlinkStatus == DOWNLINK_RECEIVED);
+  check(samplesDuringWait > 0);
+  check(wisol.pollResponse(downlink) == DOWNLINK_NONE);
+
+  //  In RCZ4 the free micro-channels are predicted after the first AT$GI? query.  A failed send
+  //  clears the prediction, so the next send queries again.
+  Wisol fcc(COUNTRY_SG, true, device, echo);
+  const bool fccFirst = fcc.sendMessage("01");  //  Queries: 6 free, 3 left.
+  delay(3000);
+  const bool fccStarted = fcc.startMessageAndGetResponse("02");  //  Predicted: 0 left.
+  delay(3000);
+  const bool fccBlocked = fcc.sendMessage("03");  //  Fails while waiting for the downlink.
+  while (fccStarted && fcc.pollResponse(downlink) == DOWNLINK_PENDING) {}
+  const uint16_t queriesAfterFailure = fcc.getChannelQueries();
+  delay(3000);
+  const bool fccRequeried = fcc.sendMessage("04");  //  Queries again: 3 left.
+  delay(3000);
+  const bool fccPredicted = fcc.sendMessage("05");  //  Predicted: 0 left.
+  const uint16_t resetsBefore = fcc.getChannelResets();
+  delay(3000);
+  const bool fccReset = fcc.sendMessage("06");  //  Resets the macro channel.
+  printf("fcc queries=%u,%u resets=%u,%u\n", queriesAfterFailure, fcc.getChannelQueries(),
+         resetsBefore, fcc.getChannelResets());
+  check(fccFirst && fccStarted && !fccBlocked && fccRequeried && fccPredicted && fccReset);
+  check(queriesAfterFailure == 1 && fcc.getChannelQueries() == 2);
+  check(resetsBefore == 0 && fcc.getChannelResets() == 1);
+
+  //  Bytes drained before a command are a late response to the last command, or stray bytes.
+  Wisol drained(COUNTRY_SG, true, device, false);
+  drained.classifyLateResponse("OK\r\n");
+  drained.classifyLateResponse("ERR_SFX-ERR_SEND_FRAME_WAIT_TIMEOUT\r\n");
+  drained.classifyLateResponse("RX=01 02 03 04 05 06 07 08\r\n");
+  drained.classifyLateResponse("\r\n~#q\r\n");  //  Noise: 3 bytes after trimming.
+  drained.classifyLateResponse("");
+  printf("wisol late=%u stray=%u\n", drained.getLateResponses(), drained.getStrayBytes());
+  check(drained.getLateResponses() == 3 && drained.getStrayBytes() == 3);
+  Radiocrafts drainedRadiocrafts(COUNTRY_SG, true, device, false);
+  drainedRadiocrafts.classifyLateResponse("3e");  //  '>' prompt.
+  drainedRadiocrafts.classifyLateResponse("01023e");  //  Response ending with the prompt.
+  drainedRadiocrafts.classifyLateResponse("0102");  //  Noise: 2 bytes.
+  drainedRadiocrafts.classifyLateResponse("3e01");  //  Noise after the prompt: 2 bytes.
+  printf("radiocrafts late=%u stray=%u\n", drainedRadiocrafts.getLateResponses(),
+         drainedRadiocrafts.getStrayBytes());
+  check(drainedRadiocrafts.getLateResponses() == 2 && drainedRadiocrafts.getStrayBytes() == 4);
+
+  //  Pipelined commands with a scripted module instead of the emulator.  Wisol answers each
+  //  command with a line.  An error line fails the commands.
+  Wisol scripted(COUNTRY_SG, false, device, false);
+  const char *idReplies[] = { "002BEEF1\r\n", "1122334455667788\r\n" };
+  SoftwareSerial::script(idReplies, 2, false);
+  String scriptedID, scriptedPAC;
+  const bool idRead = scripted.getID(scriptedID, scriptedPAC);
+  const char *telemetryReplies[] = { "2510\r\n", "3300\r\n" };
+  SoftwareSerial::script(telemetryReplies, 2, false);
+  float scriptedTemperature = 0, scriptedVoltage = 0;
+  const bool scriptedTelemetry = scripted.getTelemetry(scriptedTemperature, scriptedVoltage);
+  const char *errorReplies[] = { "ERR_SFX-ERR_API_GET_ID\r\n", "1122334455667788\r\n" };
+  SoftwareSerial::script(errorReplies, 2, false);
+  const bool errorRead = scripted.getID(scriptedID, scriptedPAC);
+  printf("scripted wisol id=%s pac=%s temperature=%.2f voltage=%.2f error=%d\n", scriptedID.c_str(),
+         scriptedPAC.c_str(), scriptedTemperature, scriptedVoltage, errorRead);
+  check(idRead && scriptedID == "002BEEF1" && scriptedPAC == "1122334455667788");
+  check(scriptedTelemetry && scriptedTemperature > 25.09 && scriptedTemperature < 25.11);
+  check(scriptedVoltage > 3.29 && scriptedVoltage < 3.31);
+  check(!errorRead);
+  //  Akeru echoes each byte of the command, then answers with the data and "OK".
+  Akeru akeru;
+  const char *akeruReplies[] = { "\r\n25\r\n\r\nOK\r\n", "\r\n3.28\r\n\r\nOK\r\n" };
+  SoftwareSerial::script(akeruReplies, 2, true);
+  float akeruTemperature = 0, akeruVoltage = 0;
+  const bool akeruTelemetry = akeru.getTelemetry(akeruTemperature, akeruVoltage);
+  const char *akeruErrorReplies[] = { "\r\n25\r\n\r\nOK\r\n", "\r\nERROR\r\n" };
+  SoftwareSerial::script(akeruErrorReplies, 2, true);
+  Akeru akeruError;
+  const bool akeruErrorRead = akeruError.getTelemetry(akeruTemperature, akeruVoltage);
+  SoftwareSerial::endScript();
+  printf("scripted akeru temperature=%.1f voltage=%.2f error=%d\n", akeruTemperature, akeruVoltage,
+         akeruErrorRead);
+  check(akeruTelemetry && akeruTemperature == 25 && akeruVoltage > 3.27 && akeruVoltage < 3.29);
+  check(!akeruErrorRead);
+
+  //  Heartbeats send a bit frame with AT$SB=.  In RCZ4 Wisol checks the macro channel first, in RCZ1 it doesn't.
+  Wisol heartbeatRCZ4(COUNTRY_SG, true, device, echo);
+  const bool heartbeatRCZ4Sent = heartbeatRCZ4.sendHeartbeat();
+  Wisol heartbeatRCZ1(COUNTRY_FR, true, device, echo);
+  const bool heartbeatRCZ1Sent = heartbeatRCZ1.sendHeartbeat(false);
+  printf("wisol heartbeat RCZ4 sent=%d queries=%u, RCZ1 sent=%d queries=%u\n", heartbeatRCZ4Sent,
+         heartbeatRCZ4.getChannelQueries(), heartbeatRCZ1Sent, heartbeatRCZ1.getChannelQueries());
+  check(heartbeatRCZ4Sent && heartbeatRCZ4.getChannelQueries() == 1);
+  check(heartbeatRCZ1Sent && heartbeatRCZ1.getChannelQueries() == 0);
+  Akeru akeruHeartbeat;
+  const char *heartbeatReplies[] = { "\r\nOK\r\n" };
+  SoftwareSerial::script(heartbeatReplies, 1, true);
+  const bool akeruHeartbeatSent = akeruHeartbeat.sendHeartbeat();
+  const String akeruHeartbeatCommand = SoftwareSerial::getWritten();
+  SoftwareSerial::endScript();
+  check(akeruHeartbeatSent && akeruHeartbeatCommand == "AT$SB=1\r\n");
+
+  //  The scheduler logs the samples of a failed send, and backfills them after the next send.
+  SampleLog outageLog;
+  outageLog.clear();  outageLog.begin(1);  outageLog.setNames(Message::nameCode("tmp"));
+  Message msg10(transceiver);
+  msg10.setEchoMode(ECHO_NONE);
+  Scheduler outageScheduler(msg10);
+  const int outageField = outageScheduler.addField("tmp", AGGREGATE_LAST);
+  outageScheduler.setSampleLog(outageLog);
+  delay(3000);
+  transceiver.sendHeartbeat();  //  The scheduled send fails, because the transceiver just sent.
+  outageScheduler.record(outageField, 25.6);
+  outageScheduler.requestSend();
+  outageScheduler.run();
+  const uint16_t outagePending = outageLog.getPendingCount();
+  delay(3000);
+  outageScheduler.record(outageField, 26.0);
+  outageScheduler.requestSend();
+  outageScheduler.run();
+  const bool outageSent = outageScheduler.lastSendOK();
+  for (int i = 0; i < 100 && outageLog.getPendingCount() > 0; i++) delay(outageScheduler.run());
+  printf("samplelog scheduler pending=%u sent=%d after=%u\n", outagePending, outageSent,
+         outageLog.getPendingCount());
+  check(outagePending == 1 && outageSent && outageLog.getPendingCount() == 0);
 
 #if NOTUSED
   setup();
@@ -36,6 +464,7 @@ int main() {
     break;
   }
 #endif
-  return 0;
+  printf("test: %d failures\n", failures);
+  return failures == 0 ? 0 : 1;
 }
 #endif  //  ARDUINO
@@ -1,10 +1,7 @@
 //  Util functions available on Arduino but missing on Windows/Mac.
+//  Include this into one translation unit.  Other translation units include util.h.
 #ifndef ARDUINO
-#include <stdio.h>
-#include <stdlib.h>
-#include <stdint.h>
-#include <unistd.h>
-#include <time.h>
+#include "util.h"
 
 char *ltoa(long num, char *str, int radix) {
   char sign = 0;
@@ -154,38 +151,51 @@ char *dtostrf(double value, unsigned char d1, unsigned char d2, char *buf) {
   return (char *) "888";
 }
 
-#define strcpy_P strcpy
-#define strlen_P strlen
-typedef const char *PSTR;
-typedef const char *PGM_P;
 #include "LocalWString.cpp"
 
-class Print {
-public:
-  Print() {}
-  Print(unsigned rx, unsigned tx) {}
-  void begin(int i) {}
-  void print(const char *s) { printf(s); }
-  void print(const String &s) { printf(s.c_str()); }
-  void print(int i) { printf("%d", i); }
-  void print(float f) { printf("%f", f); }
-  void println(const char *s) { puts(s); }
-  void println(const String &s) { puts(s.c_str()); }
-  void println(int i) { printf("%d\n", i); }
-  void println(float f) { printf("%f\n", f); }
-  void flush() {}
-  void listen() {}
-  void write(uint8_t ch) { putchar(ch); }
-  int read() { return -1; }
-  bool available() { return false; }
-  void end() {}
-};
 Print Serial;
 
-class SoftwareSerial: public Print {
-public:
-  SoftwareSerial(unsigned rx, unsigned tx): Print(rx, tx) {}
-};
+//  Scripted module for testing the drivers without the emulator.  When a command line ends
+//  with '\r', the next reply is received once the bytes before it have been read, e.g. the
+//  echo of the command by Akeru.
+static const char **scriptReplies = 0;  //  Replies not sent yet.
+static uint8_t scriptCount = 0;  //  Number of replies not sent yet.
+static bool scriptEcho = false;  //  True if the module echoes each byte written.
+static bool scriptPending = false;  //  True if a command line has ended and its reply is not sent yet.
+static String scriptInput;  //  Bytes received but not read yet.
+static String scriptOutput;  //  Bytes written since the script started.
+
+void SoftwareSerial::script(const char *replies[], uint8_t count, bool echo) {
+  scriptReplies = replies;  scriptCount = count;  scriptEcho = echo;
+  scriptPending = false;  scriptInput = "";  scriptOutput = "";
+}
+
+void SoftwareSerial::endScript() { script(0, 0, false); }
+
+String SoftwareSerial::getWritten() { return scriptOutput; }
+
+size_t SoftwareSerial::write(uint8_t ch) {
+  if (scriptReplies == 0) return Print::write(ch);
+  scriptOutput.concat((char) ch);
+  if (scriptEcho) scriptInput.concat((char) ch);
+  if (ch == '\r' && scriptCount > 0) scriptPending = true;
+  return 1;
+}
+
+int SoftwareSerial::available() {
+  if (scriptPending && scriptInput.length() == 0) {
+    scriptInput = *scriptReplies++;  scriptCount--;
+    scriptPending = false;
+  }
+  return (int) scriptInput.length();
+}
+
+int SoftwareSerial::read() {
+  if (available() == 0) return -1;
+  const int ch = (uint8_t) scriptInput.charAt(0);
+  scriptInput = scriptInput.substring(1);
+  return ch;
+}
 
 unsigned long millis() {
   return (unsigned long) clock();
@@ -198,6 +208,4 @@ void delay(long i) {  //  Milliseconds.
   }
 }
 
-typedef uint8_t byte;
-
 #endif  //  ARDUINO
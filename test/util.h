@@ -0,0 +1,67 @@
+//  Declare the util functions and classes available on Arduino but missing on Windows/Mac.
+//  Defined in util.cpp.
+#ifndef UNABIZ_ARDUINO_TEST_UTIL_H
+#define UNABIZ_ARDUINO_TEST_UTIL_H
+#ifndef ARDUINO
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+
+char *ltoa(long num, char *str, int radix);
+char *utoa(unsigned num, char *str, int radix);
+char *itoa(int num, char *str, int radix);
+char *ultoa(unsigned long num, char *str, int radix);
+char *dtostrf(double value, unsigned char d1, unsigned char d2, char *buf);
+
+#define strcpy_P strcpy
+#define strlen_P strlen
+typedef const char *PSTR;
+typedef const char *PGM_P;
+#include "LocalWString.h"
+
+class Print {
+  //  Like Arduino, all output goes through write() so that subclasses like NullPort can drop the output.
+public:
+  Print() {}
+  Print(unsigned rx, unsigned tx) {}
+  void begin(int i) {}
+  void print(char ch) { write((uint8_t) ch); }
+  void print(const char *s) { while (*s) write((uint8_t) *s++); }
+  void print(const String &s) { print(s.c_str()); }
+  void print(int i) { char buf[16]; snprintf(buf, sizeof(buf), "%d", i); print(buf); }
+  void print(float f) { char buf[32]; snprintf(buf, sizeof(buf), "%f", f); print(buf); }
+  void println(const char *s) { print(s); write('\n'); }
+  void println(const String &s) { print(s); write('\n'); }
+  void println(int i) { print(i); write('\n'); }
+  void println(float f) { print(f); write('\n'); }
+  void flush() {}
+  void listen() {}
+  virtual size_t write(uint8_t ch) { putchar(ch); return 1; }
+  int read() { return -1; }
+  bool available() { return false; }
+  void end() {}
+};
+extern Print Serial;
+
+class SoftwareSerial: public Print {
+  //  Without a script, output goes to the console and nothing is received.
+public:
+  SoftwareSerial(unsigned rx, unsigned tx): Print(rx, tx) {}
+  static void script(const char *replies[], uint8_t count, bool echo);  //  Reply to each command line with the next reply.
+  static void endScript();  //  Stop replying.
+  static String getWritten();  //  Return the bytes written since the script started.
+  virtual size_t write(uint8_t ch);
+  int read();
+  int available();
+};
+
+unsigned long millis();
+void delay(long i);  //  Milliseconds.
+
+typedef uint8_t byte;
+
+#endif  //  ARDUINO
+#endif  //  UNABIZ_ARDUINO_TEST_UTIL_H
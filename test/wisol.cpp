@@ -0,0 +1,7 @@
+//  Build Wisol.cpp in its own translation unit for testing under Windows or Mac.
+//  Wisol.cpp and Radiocrafts.cpp define the same macros and statics for their modules,
+//  like separate library sources on Arduino, so they can't share sigfox.cpp.
+#ifndef ARDUINO
+#include "util.h"
+#include "../Wisol.cpp"
+#endif  //  ARDUINO